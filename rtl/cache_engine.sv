@@ -44,8 +44,14 @@ module cache_engine (
     L1_index,
     L2_tag,
     L2_index,
-    output reg [31:0] L1_cache[0:L1_NUMSETS-1][0:L1_ASSOC-1],
-    output reg [31:0] L2_cache[0:L2_NUMSETS-1][0:L2_ASSOC-1]
+    // Debug read port, serviced while the FSM is idle. The cycle after
+    // dbg_set is presented, dbg_tag and dbg_valid hold way dbg_way of that
+    // set in L1 (dbg_level 0) or L2 (dbg_level 1)
+    input dbg_level,
+    input [11:0] dbg_set,
+    input [7:0] dbg_way,
+    output [31:0] dbg_tag,
+    output dbg_valid
 );
 
 
@@ -56,11 +62,79 @@ module cache_engine (
 
   // Counter variables
   reg L1_found, L2_found;
-  integer i, j, L1_lru_index, L2_lru_index;
+  integer i, k, L1_lru_index, L2_lru_index;
 
   // Temporary variables
   reg [31:0] back_inval;
 
+  // Tag storage, one word per set with way i in bits [32*i +: 32]. Sets are
+  // only read through a registered port and written whole, so the arrays
+  // map onto block RAM, and they are never reset
+  reg [32*L1_ASSOC-1:0] L1_tags[0:L1_NUMSETS-1];
+  reg [32*L2_ASSOC-1:0] L2_tags[0:L2_NUMSETS-1];
+
+  // Valid bits, way i of set s at [s*ASSOC + i], kept in flip-flops so a
+  // reset invalidates every way at once
+  reg [L1_NUMSETS*L1_ASSOC-1:0] L1_valid;
+  reg [L2_NUMSETS*L2_ASSOC-1:0] L2_valid;
+
+  // Set read for the current access (or the debug port), and the write of
+  // the set the FSM has updated, one cycle behind it
+  reg [32*L1_ASSOC-1:0] L1_set, L1_wdata;
+  reg [32*L2_ASSOC-1:0] L2_set, L2_wdata;
+  reg [L1_ASSOC-1:0] L1_set_valid;
+  reg [L2_ASSOC-1:0] L2_set_valid;
+  reg L1_we, L2_we;
+  reg [31:0] L1_windex, L2_windex;
+  reg dbg_level_q;
+  reg [7:0] dbg_way_q;
+
+  // Ways as {valid, tag}, old as read and new as the FSM shifts them with
+  // blocking assignments. A clear valid bit marks the empty ways a 0 tag used to
+  reg [32:0] L1_old[0:L1_ASSOC-1], L1_new[0:L1_ASSOC-1];
+  reg [32:0] L2_old[0:L2_ASSOC-1], L2_new[0:L2_ASSOC-1];
+
+  // The FSM reads on its way from IDLE to READ, the debug port in any other idle cycle
+  wire read_en = state == IDLE;
+  wire [31:0] L1_rindex = next_state == READ ? (cache_addr / BLOCKSIZE) % L1_NUMSETS : dbg_set % L1_NUMSETS;
+  wire [31:0] L2_rindex = next_state == READ ? (cache_addr / BLOCKSIZE) % L2_NUMSETS : dbg_set % L2_NUMSETS;
+
+  always @(posedge clk) begin
+    if (L1_we) L1_tags[L1_windex] <= L1_wdata;
+    if (read_en) L1_set <= L1_tags[L1_rindex];
+  end
+
+  always @(posedge clk) begin
+    if (L2_we) L2_tags[L2_windex] <= L2_wdata;
+    if (read_en) L2_set <= L2_tags[L2_rindex];
+  end
+
+  always @(posedge clk) begin
+    if (read_en) begin
+      L1_set_valid <= L1_valid[L1_rindex*L1_ASSOC+:L1_ASSOC];
+      L2_set_valid <= L2_valid[L2_rindex*L2_ASSOC+:L2_ASSOC];
+      dbg_level_q <= dbg_level;
+      dbg_way_q <= dbg_way;
+    end
+  end
+
+  always @(*) begin
+    for (k = 0; k < L1_ASSOC; k = k + 1) L1_old[k] = {L1_set_valid[k], L1_set[32*k+:32]};
+    for (k = 0; k < L2_ASSOC; k = k + 1) L2_old[k] = {L2_set_valid[k], L2_set[32*k+:32]};
+  end
+
+  assign dbg_tag = dbg_level_q ? L2_set[32*dbg_way_q+:32] : L1_set[32*dbg_way_q+:32];
+  assign dbg_valid = dbg_level_q ? L2_set_valid[dbg_way_q] : L1_set_valid[dbg_way_q];
+
+  // Move ways last-1 .. 0 of the set down by one
+  task automatic L1_shift(input integer last);
+    for (integer w = last; w > 0; w = w - 1) L1_new[w] = L1_old[w-1];
+  endtask
+
+  task automatic L2_shift(input integer last);
+    for (integer w = last; w > 0; w = w - 1) L2_new[w] = L2_old[w-1];
+  endtask
+
   // Replacement policy FSM | Combinational logic
   always @(*) begin
 
@@ -76,12 +150,12 @@ module cache_engine (
       SEARCH: begin
         // FIFO
         if (replace_policy == 0) begin
-          next_state <= (L1_found | L2_found) ? CACHEHIT:(L1_cache[L1_index][L1_ASSOC-1] != 0 || L2_cache[L2_index][L2_ASSOC-1]) ? SHIFTFULL:SHIFTEMPTY;
+          next_state <= (L1_found | L2_found) ? CACHEHIT:(L1_old[L1_ASSOC-1][32] || L2_old[L2_ASSOC-1][32]) ? SHIFTFULL:SHIFTEMPTY;
         end
 
             // LRU | If cache hit, go to LRUHIT logic, if cache miss proceed with FIFO-like shifitng
         else
-          next_state <= (L1_found | L2_found) ? CACHEHIT:(L1_cache[L1_index][L1_ASSOC-1] != 0 || L2_cache[L2_index][L2_ASSOC-1]) ? SHIFTFULL:SHIFTEMPTY;
+          next_state <= (L1_found | L2_found) ? CACHEHIT:(L1_old[L1_ASSOC-1][32] || L2_old[L2_ASSOC-1][32]) ? SHIFTFULL:SHIFTEMPTY;
       end
 
       // Shift if current cache is Full FIFO or Full LRU Miss
@@ -121,23 +195,19 @@ module cache_engine (
       L2_found <= 1'b0;
       prev_addr <= 48'b0;
       back_inval <= 32'b0;
+      L1_we <= 1'b0;
+      L2_we <= 1'b0;
 
-      // Clear for L1
-      for (i = 0; i < L1_NUMSETS; i = i + 1) begin
-        for (j = 0; j < L1_ASSOC; j = j + 1) begin
-          L1_cache[i][j] = 32'b0;
-        end
-      end
-
-      // Clear for L2
-      for (i = 0; i < L2_NUMSETS; i = i + 1) begin
-        for (j = 0; j < L2_ASSOC; j = j + 1) begin
-          L2_cache[i][j] = 32'b0;
-        end
-      end
+      // Flash invalidate both caches
+      L1_valid <= '0;
+      L2_valid <= '0;
     end  // Flexible Cache Logic
     else begin
       state <= next_state;
+      L1_we <= 1'b0;
+      L2_we <= 1'b0;
+      for (i = 0; i < L1_ASSOC; i = i + 1) L1_new[i] = L1_old[i];
+      for (i = 0; i < L2_ASSOC; i = i + 1) L2_new[i] = L2_old[i];
 
       // If an address has been read, increment reads, get tag & index for FSM
       if (next_state == READ) begin
@@ -167,7 +237,7 @@ module cache_engine (
 
           // L1 Cache | If tag found in cache, mark as found and mark LRU tag index
           for (i = 0; i < L1_ASSOC; i = i + 1) begin
-            if (L1_tag == L1_cache[L1_index][i]) begin
+            if (L1_old[i] == {1'b1, L1_tag}) begin
               L1_found <= 1'b1;
               L1_hits  <= L1_hits + 1;
               break;
@@ -176,7 +246,7 @@ module cache_engine (
 
           // L2 Cache | If tag found in cache, mark as found and mark LRU tag index
           for (i = 0; i < L2_ASSOC; i = i + 1) begin
-            if (L2_tag == L2_cache[L2_index][i]) begin
+            if (L2_old[i] == {1'b1, L2_tag}) begin
               L2_found <= 1'b1;
               break;
             end
@@ -186,7 +256,7 @@ module cache_engine (
 
           // L1 Cache | If tag found in cache, mark as found and mark LRU tag index
           for (i = 0; i < L1_ASSOC; i = i + 1) begin
-            if (L1_tag == L1_cache[L1_index][i]) begin
+            if (L1_old[i] == {1'b1, L1_tag}) begin
               L1_found <= 1'b1;
               L1_hits  <= L1_hits + 1;
               L1_lru_index = i;
@@ -196,7 +266,7 @@ module cache_engine (
 
           // L2 Cache | If tag found in cache, mark as found and mark LRU tag index
           for (i = 0; i < L2_ASSOC; i = i + 1) begin
-            if (L2_tag == L2_cache[L2_index][i]) begin
+            if (L2_old[i] == {1'b1, L2_tag}) begin
               L2_found <= 1'b1;
               L2_lru_index = i;
               break;
@@ -221,55 +291,47 @@ module cache_engine (
         // If replace policy is inclusive and L1 & L2 miss
         if (inclusion_policy == 0) begin
 
-          L1_cache[L1_index][L1_ASSOC-1] <= 32'b0;
+          L1_new[L1_ASSOC-1] = 33'b0;
           // Shifts through the current set with the size of the cache line to shift in FIFO order
-          for (i = L1_ASSOC - 1; i >= 0; i = i - 1) begin
-            L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-          end
+          L1_shift(L1_ASSOC - 1);
 
           // Case for back invalidation
-          if (L2_cache[L2_index][L2_ASSOC-1] != 0) begin
+          if (L2_old[L2_ASSOC-1][32]) begin
             back_inval <= L1_tag;
-            L2_cache[L2_index][L2_ASSOC-1] <= 32'b0;
+            L2_new[L2_ASSOC-1] = 33'b0;
 
             for (i = L1_ASSOC - 1; i >= 0; i = i - 1) begin
 
-              if (back_inval == L1_tag) L1_cache[L1_index][i] <= 32'b0;
+              if (back_inval == L1_tag) L1_new[i] = 33'b0;
 
             end
 
           end
 
           // Shifts through the current set with the size of the cache line to shift in FIFO order
-          for (i = L2_ASSOC - 1; i >= 0; i = i - 1) begin
-            L2_cache[L2_index][i] <= L2_cache[L2_index][i-1];
-          end
+          L2_shift(L2_ASSOC - 1);
 
-          L2_cache[L2_index][0] <= L2_tag;
+          L2_new[0] = {1'b1, L2_tag};
 
         end
 
         // If the current inclusion policy is Non-inclusive and L1 & L2 miss, then insert tag in both caches
         if (inclusion_policy == 1) begin
 
-          L1_cache[L1_index][L1_ASSOC-1] <= 32'b0;
+          L1_new[L1_ASSOC-1] = 33'b0;
           // Shifts through the current set with the size of the cache line to shift in FIFO order
-          for (i = L1_ASSOC; i > 0; i = i - 1) begin
-            L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-          end
+          L1_shift(L1_ASSOC - 1);
 
-          if (L2_cache[L2_index][L2_ASSOC-1] != 0) L2_cache[L2_index][L2_ASSOC-1] <= 32'b0;
+          if (L2_old[L2_ASSOC-1][32]) L2_new[L2_ASSOC-1] = 33'b0;
 
           // Shifts through the current set with the size of the cache line to shift in FIFO order
-          for (i = L2_ASSOC; i > 0; i = i - 1) begin
-            L2_cache[L2_index][i] <= L2_cache[L2_index][i-1];
-          end
+          L2_shift(L2_ASSOC - 1);
 
-          L2_cache[L2_index][0] <= L2_tag;
+          L2_new[0] = {1'b1, L2_tag};
 
         end
         // Insert new address at beginning of cache line
-        L1_cache[L1_index][0] <= L1_tag;
+        L1_new[0] = {1'b1, L1_tag};
       end  // Shift logic if the cache for LRU or FIFO isn't full
       else if (next_state == SHIFTEMPTY) begin
 
@@ -285,43 +347,16 @@ module cache_engine (
         end
 
 
-        // If replace policy is inclusive and L1 & L2 miss
-        if (inclusion_policy == 0) begin
-
-          // Shifts through the current set with the size of the cache line to shift in FIFO order
-          for (i = L1_ASSOC - 1; i >= 0; i = i - 1) begin
-            L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-          end
-          // Pop out last address out of cache before shifting
-          L1_cache[L1_index][0] <= L1_tag;
-
-          // Shifts through the current set with the size of the cache line to shift in FIFO order
-          for (i = L2_ASSOC - 1; i >= 0; i = i - 1) begin
-            L2_cache[L2_index][i] <= L2_cache[L2_index][i-1];
-          end
-
-          L2_cache[L2_index][0] <= L2_tag;
-
-        end
-
-        // If the current inclusion policy is Non-inclusive and L1 & L2 miss, then insert tag in both caches
-        if (inclusion_policy == 1) begin
-
-          // Shifts through the current set with the size of the cache line to shift in FIFO order
-          for (i = L1_ASSOC - 1; i >= 0; i = i - 1) begin
-            L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-          end
-          // Pop out last address out of cache before shifting
-          L1_cache[L1_index][0] <= L1_tag;
-
-          // Shifts through the current set with the size of the cache line to shift in FIFO order
-          for (i = L2_ASSOC - 1; i >= 0; i = i - 1) begin
-            L2_cache[L2_index][i] <= L2_cache[L2_index][i-1];
-          end
+        // Inclusive and non-inclusive both insert the tag in both caches on a miss
+        // Shifts through the current set with the size of the cache line to shift in FIFO order
+        L1_shift(L1_ASSOC - 1);
+        // Pop out last address out of cache before shifting
+        L1_new[0] = {1'b1, L1_tag};
 
-          L2_cache[L2_index][0] <= L2_tag;
+        // Shifts through the current set with the size of the cache line to shift in FIFO order
+        L2_shift(L2_ASSOC - 1);
 
-        end
+        L2_new[0] = {1'b1, L2_tag};
       end  // Shift logic for LRU hit
       else if (next_state == CACHEHIT) begin
 
@@ -330,13 +365,11 @@ module cache_engine (
           // L1 cache
           if (L1_found) begin
             // Pop out LRU hit tag out of cache before shifting
-            L1_cache[L1_index][L1_lru_index] <= 32'b0;
+            L1_new[L1_lru_index] = 33'b0;
 
             // Shifts through the current set with the size of the cache line to shift in LRU order
-            for (i = L1_ASSOC - 1; i >= 0; i = i - 1) begin
-
-              if (i <= L1_lru_index) L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-            end
+            L1_shift(L1_lru_index);
+            L1_new[0] = 33'b0;
 
             // If (inclusion policy is inclusive and L1 hits while L2 misses) == false
             if (!(inclusion_policy == 0 && !L2_found)) begin
@@ -346,7 +379,7 @@ module cache_engine (
 
 
               // Insert new address at beginning of cache line
-              L1_cache[L1_index][0] <= L1_tag;
+              L1_new[0] = {1'b1, L1_tag};
             end
           end  // L2 cache
           else if (!L1_found && L2_found) begin
@@ -357,78 +390,22 @@ module cache_engine (
               L1_writes <= L1_writes + 1;
             end
             // Pop out LRU hit tag out of cache before shifting
-            L2_cache[L2_index][L2_lru_index] <= 32'b0;
+            L2_new[L2_lru_index] = 33'b0;
 
             // Shifts through the current set with the size of the cache line to shift in LRU order
-            for (i = L2_ASSOC; i > 0; i = i - 1) begin
+            L2_shift(L2_lru_index);
 
-              if (i <= L2_lru_index) L2_cache[L2_index][i] <= L2_cache[L2_index][i-1];
-            end
+            L2_new[0] = {1'b1, L2_tag};
 
-            L2_cache[L2_index][0] <= L2_tag;
-
-            // If replace policy is inclusive and L1 miss & L2 hit
-            if (inclusion_policy == 0) begin
-              // If the current L2 set is outside the range of the L1 sets, then write tag to 1st L1 set
-              if (L2_index > L1_ASSOC - 1) begin
-                // Pop out last address out of cache before shifting
-                if (L1_cache[L1_index][L1_ASSOC-1] != 0) L1_cache[L1_index][L1_ASSOC-1] <= 32'b0;
-
-                // Shifts through the current set with the size of the cache line to shift in FIFO order
-                for (i = L1_ASSOC - 1; i > 0; i = i - 1) begin
-                  L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-                end
-
-                // Insert tag entry from L2 into L1 Set from the 1st L1 Set 
-                L1_cache[L1_index][0] <= L1_tag;
-              end
-                                
-                            // If the current L2 set is outside the range of the L1 sets, then write tag to 1st L1 set
-              else begin
-                // Pop out last address out of cache before shifting
-                if (L1_cache[L2_index][L1_ASSOC-1] != 0) L1_cache[L2_index][L1_ASSOC-1] <= 32'b0;
-
-                // Shifts through the current set with the size of the cache line to shift in FIFO order
-                for (i = L1_ASSOC - 1; i > 0; i = i - 1) begin
-                  L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-                end
-
-                // Insert tag entry from L2 into L1 Set from the L2 Set 
-                L1_cache[L1_index][0] <= L1_tag;
-              end
-            end
+            // Inclusive or non-inclusive, the tag from L2 is shifted into the L1 set
+            // Pop out last address out of cache before shifting
+            if (L1_old[L1_ASSOC-1][32]) L1_new[L1_ASSOC-1] = 33'b0;
 
-            // If replace policy is non-inclusive
-            if (inclusion_policy == 1) begin
-              // If the current L2 set is outside the range of the L1 sets, then write tag to 1st L1 set
-              if (L2_index > L1_ASSOC - 1) begin
-                // Pop out last address out of cache before shifting
-                if (L1_cache[L1_index][L1_ASSOC-1] != 0) L1_cache[L1_index][L1_ASSOC-1] <= 32'b0;
-
-                // Shifts through the current set with the size of the cache line to shift in FIFO order
-                for (i = L1_ASSOC - 1; i >= 0; i = i - 1) begin
-                  L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-                end
-
-                // Insert tag entry from L2 into L1 Set from the 1st L1 Set 
-                L1_cache[L1_index][0] <= L1_tag;
-              end
-                                
-                            // If the current L2 set is outside the range of the L1 sets, then write tag to 1st L1 set
-              else begin
-                // Pop out last address out of cache before shifting
-                if (L1_cache[L1_index][L1_ASSOC-1] != 0) L1_cache[L1_index][L1_ASSOC-1] <= 32'b0;
-
-                // Shifts through the current set with the size of the cache line to shift in FIFO order
-                for (i = L1_ASSOC - 1; i >= 0; i = i - 1) begin
-                  L1_cache[L1_index][i] <= L1_cache[L2_index][i-1];
-                end
-
-                // Insert tag entry from L2 into L1 Set from the L2 Set 
-                L1_cache[L1_index][0] <= L1_tag;
-              end
+            // Shifts through the current set with the size of the cache line to shift in FIFO order
+            L1_shift(L1_ASSOC - 1);
 
-            end
+            // Insert tag entry from L2 into L1 Set
+            L1_new[0] = {1'b1, L1_tag};
           end
         end else begin
           // L2 cache
@@ -440,75 +417,37 @@ module cache_engine (
               L1_writes <= L1_writes + 1;
             end
 
-            // If replace policy is exclusive and L1 miss & L2 hit
-
-            // If replace policy is inclusive and L1 miss & L2 hit
-            if (inclusion_policy == 0) begin
-              // If the current L2 set is outside the range of the L1 sets, then write tag to 1st L1 set
-              if (L2_index > L1_ASSOC - 1) begin
-                // Pop out last address out of cache before shifting
-                if (L1_cache[L1_index][L1_ASSOC-1] != 0) L1_cache[L1_index][L1_ASSOC-1] <= 32'b0;
-
-                // Shifts through the current set with the size of the cache line to shift in FIFO order
-                for (i = L1_ASSOC - 1; i > 0; i = i - 1) begin
-                  L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-                end
-
-                // Insert tag entry from L2 into L1 Set from the 1st L1 Set 
-                L1_cache[L1_index][0] <= L1_tag;
-              end
-                                
-                            // If the current L2 set is outside the range of the L1 sets, then write tag to 1st L1 set
-              else begin
-                // Pop out last address out of cache before shifting
-                if (L1_cache[L2_index][L1_ASSOC-1] != 0) L1_cache[L2_index][L1_ASSOC-1] <= 32'b0;
-
-                // Shifts through the current set with the size of the cache line to shift in FIFO order
-                for (i = L1_ASSOC - 1; i > 0; i = i - 1) begin
-                  L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-                end
-
-                // Insert tag entry from L2 into L1 Set from the L2 Set 
-                L1_cache[L1_index][0] <= L1_tag;
-              end
-            end
+            // Inclusive or non-inclusive, the tag from L2 is shifted into the L1 set
+            // Pop out last address out of cache before shifting
+            if (L1_old[L1_ASSOC-1][32]) L1_new[L1_ASSOC-1] = 33'b0;
 
-            // If replace policy is non-inclusive
-            if (inclusion_policy == 1) begin
-              // If the current L2 set is outside the range of the L1 sets, then write tag to 1st L1 set
-              if (L2_index > L1_ASSOC - 1) begin
-                // Pop out last address out of cache before shifting
-                if (L1_cache[L1_index][L1_ASSOC-1] != 0) L1_cache[L1_index][L1_ASSOC-1] <= 32'b0;
-
-                // Shifts through the current set with the size of the cache line to shift in FIFO order
-                for (i = L1_ASSOC - 1; i >= 0; i = i - 1) begin
-                  L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-                end
-
-                // Insert tag entry from L2 into L1 Set from the 1st L1 Set 
-                L1_cache[L1_index][0] <= L1_tag;
-              end
-                                
-                            // If the current L2 set is outside the range of the L1 sets, then write tag to 1st L1 set
-              else begin
-                // Pop out last address out of cache before shifting
-                if (L1_cache[L2_index][L1_ASSOC-1] != 0) L1_cache[L2_index][L1_ASSOC-1] <= 32'b0;
-
-                // Shifts through the current set with the size of the cache line to shift in FIFO order
-                for (i = L1_ASSOC - 1; i >= 0; i = i - 1) begin
-                  L1_cache[L1_index][i] <= L1_cache[L1_index][i-1];
-                end
-
-                // Insert tag entry from L2 into L1 Set from the L2 Set 
-                L1_cache[L1_index][0] <= L1_tag;
-              end
-            end
+            // Shifts through the current set with the size of the cache line to shift in FIFO order
+            L1_shift(L1_ASSOC - 1);
+
+            // Insert tag entry from L2 into L1 Set
+            L1_new[0] = {1'b1, L1_tag};
           end
         end
 
         L1_found <= 1'b0;
         L2_found <= 1'b0;
       end
+
+      // Write the updated sets back, tags a cycle later through the memory write ports
+      if (next_state == SHIFTFULL || next_state == SHIFTEMPTY || next_state == CACHEHIT) begin
+        L1_we <= 1'b1;
+        L2_we <= 1'b1;
+        L1_windex <= L1_index;
+        L2_windex <= L2_index;
+        for (i = 0; i < L1_ASSOC; i = i + 1) begin
+          L1_wdata[32*i+:32] <= L1_new[i][31:0];
+          L1_valid[L1_index*L1_ASSOC+i] <= L1_new[i][32];
+        end
+        for (i = 0; i < L2_ASSOC; i = i + 1) begin
+          L2_wdata[32*i+:32] <= L2_new[i][31:0];
+          L2_valid[L2_index*L2_ASSOC+i] <= L2_new[i][32];
+        end
+      end
     end
   end
 endmodule
@@ -0,0 +1,533 @@
+`timescale 1ns / 1ps
+`include "cache_params.vh"
+//////////////////////////////////////////////////////////////////////////////////
+// Company: UCF
+// Engineers: John Gierlach & Harrison Lipton
+//
+// Module Name: cache_engine_pipe
+// Project Name: Multi-level Cache project
+// Description: pipelined two level write-back, write-allocate cache that
+//   takes a new access every cycle. Same policy encodings as cache_engine.
+//
+//   decode  - split cache_addr into the L1 and L2 index and tag
+//   compare - look up the L1 set and the L2 sets in parallel and work out
+//             the new contents of every set the access touches: the L1
+//             fill, the dirty L1 victim written back into L2, the demand
+//             read of L2, and inclusive back-invalidations
+//   update  - write those sets back and bump the counters
+//
+//   compare reads sets the access in update has not written yet, so update
+//   forwards its sets to compare whenever the indices match. Tags stay in
+//   the way they were filled into, only a replacement word per set changes.
+//   With PLRU = 0 it holds a recency rank per way like the C model, 0 is the
+//   most recently used (LRU) or filled (FIFO) way, and the victim is the
+//   first invalid way or else the highest rank, so the contents match ../sim
+//   way for way. With PLRU = 1 it holds the assoc-1 bits of a pseudo-LRU
+//   tree (LRU), laid out as in ../sim's PLRU policy, or a round-robin
+//   pointer that advances past each way filled at it (FIFO).
+//////////////////////////////////////////////////////////////////////////////////
+
+module cache_engine_pipe (
+    input clk,
+    input reset,
+    input replace_policy,    // 0 -> FIFO | 1 -> LRU
+    input inclusion_policy,  // 0 -> inclusive | 1 -> non-inclusive
+    // request, accepted on every cycle in_valid and in_ready are both high
+    input in_valid,
+    output in_ready,
+    input [47:0] cache_addr,
+    input [7:0] cache_op,    // W (8'h57) writes, anything else reads
+    // high for one cycle after an access has been written back, the sets
+    // and counters include it from then on
+    output reg out_valid,
+    output reg out_l1_hit,
+    output reg [31:0] L1_reads, L1_read_misses, L1_writes, L1_write_misses, L1_write_backs,
+    output reg [31:0] L2_reads, L2_read_misses, L2_writes, L2_write_misses, L2_write_backs,
+    output reg [31:0] memory_traffic,
+    // cycles per access is cycles / accesses, cycles only counts cycles
+    // with an access waiting or in flight
+    output reg [31:0] accesses,
+    output reg [31:0] cycles
+);
+
+  localparam ADDR_BITS = 48;
+  localparam OFFSET_BITS = $clog2(BLOCKSIZE);
+  localparam BLOCK_BITS = ADDR_BITS - OFFSET_BITS;
+  localparam L1_INDEX_BITS = $clog2(L1_NUMSETS);
+  localparam L2_INDEX_BITS = $clog2(L2_NUMSETS);
+  localparam L1_TAG_BITS = BLOCK_BITS - L1_INDEX_BITS;
+  localparam L2_TAG_BITS = BLOCK_BITS - L2_INDEX_BITS;
+  localparam L1_RANK_BITS = L1_ASSOC > 1 ? $clog2(L1_ASSOC) : 1;
+  localparam L2_RANK_BITS = L2_ASSOC > 1 ? $clog2(L2_ASSOC) : 1;
+  // levels of the PLRU trees
+  localparam L1_WAY_BITS = $clog2(L1_ASSOC);
+  localparam L2_WAY_BITS = $clog2(L2_ASSOC);
+  // replacement word of a set, ranks or the wider of tree bits and pointer
+  localparam L1_REPL_BITS = !PLRU ? L1_ASSOC * L1_RANK_BITS :
+                            L1_ASSOC - 1 > L1_RANK_BITS ? L1_ASSOC - 1 : L1_RANK_BITS;
+  localparam L2_REPL_BITS = !PLRU ? L2_ASSOC * L2_RANK_BITS :
+                            L2_ASSOC - 1 > L2_RANK_BITS ? L2_ASSOC - 1 : L2_RANK_BITS;
+
+  // an L2 victim's L1 set is the L1 index of the access that evicted it
+  // only while L2 has at least as many sets
+  if (L2_NUMSETS < L1_NUMSETS) begin : g_sets_check
+    $error("cache_engine_pipe needs L2_NUMSETS >= L1_NUMSETS");
+  end
+  if (PLRU && (L1_ASSOC != 1 << L1_WAY_BITS || L2_ASSOC != 1 << L2_WAY_BITS)) begin : g_plru_check
+    $error("cache_engine_pipe needs power of 2 associativities with PLRU");
+  end
+
+  typedef logic [L1_ASSOC-1:0][L1_TAG_BITS-1:0] l1_tags_t;
+  typedef logic [L1_ASSOC-1:0][L1_RANK_BITS-1:0] l1_ranks_t;
+  typedef logic [L1_REPL_BITS-1:0] l1_repl_t;
+  typedef logic [L1_ASSOC-1:0] l1_bits_t;
+  typedef logic [L2_ASSOC-1:0][L2_TAG_BITS-1:0] l2_tags_t;
+  typedef logic [L2_ASSOC-1:0][L2_RANK_BITS-1:0] l2_ranks_t;
+  typedef logic [L2_REPL_BITS-1:0] l2_repl_t;
+  typedef logic [L2_ASSOC-1:0] l2_bits_t;
+
+  // set-major way storage, one word per set
+  l1_tags_t l1_tag[0:L1_NUMSETS-1];
+  l1_bits_t l1_valid[0:L1_NUMSETS-1];
+  l1_bits_t l1_dirty[0:L1_NUMSETS-1];
+  l1_repl_t l1_repl[0:L1_NUMSETS-1];
+  l2_tags_t l2_tag[0:L2_NUMSETS-1];
+  l2_bits_t l2_valid[0:L2_NUMSETS-1];
+  l2_bits_t l2_dirty[0:L2_NUMSETS-1];
+  l2_repl_t l2_repl[0:L2_NUMSETS-1];
+
+  // way holding tag, -1 on a miss
+  function automatic int l1_find(l1_tags_t tags, l1_bits_t valid, logic [L1_TAG_BITS-1:0] tag);
+    int way = -1;
+    for (int w = 0; w < L1_ASSOC; w++) if (valid[w] && tags[w] == tag) way = w;
+    return way;
+  endfunction
+
+  function automatic int l2_find(l2_tags_t tags, l2_bits_t valid, logic [L2_TAG_BITS-1:0] tag);
+    int way = -1;
+    for (int w = 0; w < L2_ASSOC; w++) if (valid[w] && tags[w] == tag) way = w;
+    return way;
+  endfunction
+
+  // first invalid way, otherwise the way ranked last, the way the tree
+  // points at, or the way under the pointer. Ranks are cast in and out of
+  // the replacement word, which only has their width with PLRU = 0.
+  function automatic int l1_victim(l1_bits_t valid, l1_repl_t repl, logic lru);
+    l1_ranks_t rank = l1_ranks_t'(repl);
+    int victim = 0;
+    int node = 1;
+    if (PLRU && lru) begin
+      for (int level = 0; level < L1_WAY_BITS; level++) node = 2 * node + int'(repl[node-1]);
+      victim = node - L1_ASSOC;
+    end else if (PLRU) begin
+      victim = int'(repl[L1_RANK_BITS-1:0]);
+    end else begin
+      for (int w = 0; w < L1_ASSOC; w++) if (rank[w] > rank[victim]) victim = w;
+    end
+    for (int w = L1_ASSOC - 1; w >= 0; w--) if (!valid[w]) victim = w;
+    return victim;
+  endfunction
+
+  function automatic int l2_victim(l2_bits_t valid, l2_repl_t repl, logic lru);
+    l2_ranks_t rank = l2_ranks_t'(repl);
+    int victim = 0;
+    int node = 1;
+    if (PLRU && lru) begin
+      for (int level = 0; level < L2_WAY_BITS; level++) node = 2 * node + int'(repl[node-1]);
+      victim = node - L2_ASSOC;
+    end else if (PLRU) begin
+      victim = int'(repl[L2_RANK_BITS-1:0]);
+    end else begin
+      for (int w = 0; w < L2_ASSOC; w++) if (rank[w] > rank[victim]) victim = w;
+    end
+    for (int w = L2_ASSOC - 1; w >= 0; w--) if (!valid[w]) victim = w;
+    return victim;
+  endfunction
+
+  // record a hit (fill = 0) or a fill of way. Ranks make way the most
+  // recent, every way ranked ahead of it ages by one, and FIFO only ranks
+  // fills. The tree points every node on way's path at the other half. The
+  // pointer moves on when way was filled at it.
+  function automatic l1_repl_t l1_touch(l1_repl_t repl, int way, logic lru, logic fill);
+    l1_ranks_t rank = l1_ranks_t'(repl);
+    l1_ranks_t next = rank;
+    l1_repl_t touched = repl;
+    int node = L1_ASSOC + way;
+    if (PLRU && lru) begin
+      for (int level = 0; level < L1_WAY_BITS; level++) begin
+        touched[(node >> 1) - 1] = (node & 1) == 0;
+        node = node >> 1;
+      end
+    end else if (PLRU) begin
+      if (fill && way == int'(repl[L1_RANK_BITS-1:0]))
+        touched[L1_RANK_BITS-1:0] = L1_RANK_BITS'((way + 1) % L1_ASSOC);
+    end else if (lru || fill) begin
+      for (int w = 0; w < L1_ASSOC; w++) if (rank[w] < rank[way]) next[w] = rank[w] + 1'b1;
+      next[way] = '0;
+      touched = l1_repl_t'(next);
+    end
+    return touched;
+  endfunction
+
+  function automatic l2_repl_t l2_touch(l2_repl_t repl, int way, logic lru, logic fill);
+    l2_ranks_t rank = l2_ranks_t'(repl);
+    l2_ranks_t next = rank;
+    l2_repl_t touched = repl;
+    int node = L2_ASSOC + way;
+    if (PLRU && lru) begin
+      for (int level = 0; level < L2_WAY_BITS; level++) begin
+        touched[(node >> 1) - 1] = (node & 1) == 0;
+        node = node >> 1;
+      end
+    end else if (PLRU) begin
+      if (fill && way == int'(repl[L2_RANK_BITS-1:0]))
+        touched[L2_RANK_BITS-1:0] = L2_RANK_BITS'((way + 1) % L2_ASSOC);
+    end else if (lru || fill) begin
+      for (int w = 0; w < L2_ASSOC; w++) if (rank[w] < rank[way]) next[w] = rank[w] + 1'b1;
+      next[way] = '0;
+      touched = l2_repl_t'(next);
+    end
+    return touched;
+  endfunction
+
+  // reset state, ranks in way order, or a clear tree and pointer
+  function automatic l1_repl_t l1_repl_reset();
+    l1_ranks_t rank;
+    for (int w = 0; w < L1_ASSOC; w++) rank[w] = L1_RANK_BITS'(w);
+    return PLRU ? '0 : l1_repl_t'(rank);
+  endfunction
+
+  function automatic l2_repl_t l2_repl_reset();
+    l2_ranks_t rank;
+    for (int w = 0; w < L2_ASSOC; w++) rank[w] = L2_RANK_BITS'(w);
+    return PLRU ? '0 : l2_repl_t'(rank);
+  endfunction
+
+  // Decode stage
+  reg d_valid, d_write;
+  reg [L1_INDEX_BITS-1:0] d_l1_index;
+  reg [L1_TAG_BITS-1:0] d_l1_tag;
+  reg [L2_INDEX_BITS-1:0] d_l2_index;
+  reg [L2_TAG_BITS-1:0] d_l2_tag;
+
+  assign in_ready = !reset;
+
+  always @(posedge clk) begin
+    if (reset) begin
+      d_valid <= 1'b0;
+    end else begin
+      d_valid <= in_valid;
+      d_write <= cache_op == 8'h57;
+      d_l1_index <= cache_addr[OFFSET_BITS+:L1_INDEX_BITS];
+      d_l1_tag <= cache_addr[ADDR_BITS-1:OFFSET_BITS+L1_INDEX_BITS];
+      d_l2_index <= cache_addr[OFFSET_BITS+:L2_INDEX_BITS];
+      d_l2_tag <= cache_addr[ADDR_BITS-1:OFFSET_BITS+L2_INDEX_BITS];
+    end
+  end
+
+  // Update stage registers, forwarded to compare below
+  reg u_valid, u_l1_hit;
+  reg [L1_INDEX_BITS-1:0] u_l1_index;
+  l1_tags_t u_a_tag;
+  l1_bits_t u_a_valid, u_a_dirty;
+  l1_repl_t u_a_repl;
+  // x is the L2 set a dirty L1 victim is written back to, y the set of the
+  // demand read, when both are the same set only y is written
+  reg u_x_we, u_y_we;
+  reg [L2_INDEX_BITS-1:0] u_x_index, u_y_index;
+  l2_tags_t u_x_tag, u_y_tag;
+  l2_bits_t u_x_valid, u_x_dirty, u_y_valid, u_y_dirty;
+  l2_repl_t u_x_repl, u_y_repl;
+  reg u_l1_read, u_l1_read_miss, u_l1_write, u_l1_write_miss, u_l1_write_back;
+  reg u_l2_read, u_l2_read_miss, u_l2_write, u_l2_write_miss;
+  reg [1:0] u_l2_write_backs;
+  reg [2:0] u_traffic;
+
+  // Compare stage
+  l1_tags_t a_tag;
+  l1_bits_t a_valid, a_dirty;
+  l1_repl_t a_repl;
+  reg x_we, y_we;
+  reg [L2_INDEX_BITS-1:0] x_index;
+  reg [L2_TAG_BITS-1:0] x_block_tag;
+  l2_tags_t x_tag, y_tag;
+  l2_bits_t x_valid, x_dirty, y_valid, y_dirty;
+  l2_repl_t x_repl, y_repl;
+  reg c_l1_hit, c_l1_write_back;
+  reg c_l2_read, c_l2_read_miss, c_l2_write, c_l2_write_miss;
+  reg [1:0] c_l2_write_backs;
+  reg [2:0] c_traffic;
+  reg [BLOCK_BITS-1:0] victim_block;
+  int hit_way, l1_way, l2_way, held;
+
+  always_comb begin
+    // the L1 set, as the access in update leaves it
+    if (u_valid && u_l1_index == d_l1_index) begin
+      a_tag = u_a_tag;
+      a_valid = u_a_valid;
+      a_dirty = u_a_dirty;
+      a_repl = u_a_repl;
+    end else begin
+      a_tag = l1_tag[d_l1_index];
+      a_valid = l1_valid[d_l1_index];
+      a_dirty = l1_dirty[d_l1_index];
+      a_repl = l1_repl[d_l1_index];
+    end
+    // the demand read's L2 set, likewise
+    if (u_y_we && u_y_index == d_l2_index) begin
+      y_tag = u_y_tag;
+      y_valid = u_y_valid;
+      y_dirty = u_y_dirty;
+      y_repl = u_y_repl;
+    end else if (u_x_we && u_x_index == d_l2_index) begin
+      y_tag = u_x_tag;
+      y_valid = u_x_valid;
+      y_dirty = u_x_dirty;
+      y_repl = u_x_repl;
+    end else begin
+      y_tag = l2_tag[d_l2_index];
+      y_valid = l2_valid[d_l2_index];
+      y_dirty = l2_dirty[d_l2_index];
+      y_repl = l2_repl[d_l2_index];
+    end
+
+    x_we = 1'b0;
+    y_we = 1'b0;
+    x_index = '0;
+    x_block_tag = '0;
+    x_tag = '0;
+    x_valid = '0;
+    x_dirty = '0;
+    x_repl = '0;
+    c_l1_hit = 1'b0;
+    c_l1_write_back = 1'b0;
+    c_l2_read = 1'b0;
+    c_l2_read_miss = 1'b0;
+    c_l2_write = 1'b0;
+    c_l2_write_miss = 1'b0;
+    c_l2_write_backs = '0;
+    c_traffic = '0;
+    victim_block = '0;
+    l1_way = 0;
+    l2_way = 0;
+    held = -1;
+
+    hit_way = l1_find(a_tag, a_valid, d_l1_tag);
+    if (d_valid && hit_way >= 0) begin
+      c_l1_hit = 1'b1;
+      a_repl = l1_touch(a_repl, hit_way, replace_policy, 1'b0);
+      if (d_write) a_dirty[hit_way] = 1'b1;
+    end else if (d_valid) begin
+      l1_way = l1_victim(a_valid, a_repl, replace_policy);
+
+      // evict the L1 victim, a dirty one is written into L2 set x
+      if (a_valid[l1_way] && a_dirty[l1_way]) begin
+        c_l1_write_back = 1'b1;
+        c_l2_write = 1'b1;
+        victim_block = {a_tag[l1_way], d_l1_index};
+        x_index = victim_block[L2_INDEX_BITS-1:0];
+        x_block_tag = victim_block[BLOCK_BITS-1:L2_INDEX_BITS];
+        x_we = 1'b1;
+        if (u_y_we && u_y_index == x_index) begin
+          x_tag = u_y_tag;
+          x_valid = u_y_valid;
+          x_dirty = u_y_dirty;
+          x_repl = u_y_repl;
+        end else if (u_x_we && u_x_index == x_index) begin
+          x_tag = u_x_tag;
+          x_valid = u_x_valid;
+          x_dirty = u_x_dirty;
+          x_repl = u_x_repl;
+        end else begin
+          x_tag = l2_tag[x_index];
+          x_valid = l2_valid[x_index];
+          x_dirty = l2_dirty[x_index];
+          x_repl = l2_repl[x_index];
+        end
+      end
+      a_valid[l1_way] = 1'b0;
+      a_dirty[l1_way] = 1'b0;
+
+      if (x_we) begin
+        l2_way = l2_find(x_tag, x_valid, x_block_tag);
+        if (l2_way >= 0) begin
+          x_repl = l2_touch(x_repl, l2_way, replace_policy, 1'b0);
+          x_dirty[l2_way] = 1'b1;
+        end else begin
+          c_l2_write_miss = 1'b1;
+          l2_way = l2_victim(x_valid, x_repl, replace_policy);
+          if (x_valid[l2_way]) begin
+            if (x_dirty[l2_way]) begin
+              c_l2_write_backs = c_l2_write_backs + 1'b1;
+              c_traffic = c_traffic + 1'b1;
+            end
+            // inclusive L2 victims leave L1, dirty copies go to memory
+            if (inclusion_policy == 0) begin
+              victim_block = {x_tag[l2_way], x_index};
+              held = l1_find(a_tag, a_valid, victim_block[BLOCK_BITS-1:L1_INDEX_BITS]);
+              if (held >= 0) begin
+                if (a_dirty[held]) c_traffic = c_traffic + 1'b1;
+                a_valid[held] = 1'b0;
+                a_dirty[held] = 1'b0;
+              end
+            end
+          end
+          c_traffic = c_traffic + 1'b1;
+          x_tag[l2_way] = x_block_tag;
+          x_valid[l2_way] = 1'b1;
+          x_dirty[l2_way] = 1'b1;
+          x_repl = l2_touch(x_repl, l2_way, replace_policy, 1'b1);
+        end
+        // the demand read sees the write back when both hit the same set
+        if (x_index == d_l2_index) begin
+          y_tag = x_tag;
+          y_valid = x_valid;
+          y_dirty = x_dirty;
+          y_repl = x_repl;
+          x_we = 1'b0;
+        end
+      end
+
+      // demand read of the block from L2, then fill L1
+      c_l2_read = 1'b1;
+      y_we = 1'b1;
+      l2_way = l2_find(y_tag, y_valid, d_l2_tag);
+      if (l2_way >= 0) begin
+        y_repl = l2_touch(y_repl, l2_way, replace_policy, 1'b0);
+      end else begin
+        c_l2_read_miss = 1'b1;
+        l2_way = l2_victim(y_valid, y_repl, replace_policy);
+        if (y_valid[l2_way]) begin
+          if (y_dirty[l2_way]) begin
+            c_l2_write_backs = c_l2_write_backs + 1'b1;
+            c_traffic = c_traffic + 1'b1;
+          end
+          if (inclusion_policy == 0) begin
+            victim_block = {y_tag[l2_way], d_l2_index};
+            held = l1_find(a_tag, a_valid, victim_block[BLOCK_BITS-1:L1_INDEX_BITS]);
+            if (held >= 0) begin
+              if (a_dirty[held]) c_traffic = c_traffic + 1'b1;
+              a_valid[held] = 1'b0;
+              a_dirty[held] = 1'b0;
+            end
+          end
+        end
+        c_traffic = c_traffic + 1'b1;
+        y_tag[l2_way] = d_l2_tag;
+        y_valid[l2_way] = 1'b1;
+        y_dirty[l2_way] = 1'b0;
+        y_repl = l2_touch(y_repl, l2_way, replace_policy, 1'b1);
+      end
+
+      a_tag[l1_way] = d_l1_tag;
+      a_valid[l1_way] = 1'b1;
+      a_dirty[l1_way] = d_write;
+      a_repl = l1_touch(a_repl, l1_way, replace_policy, 1'b1);
+    end
+  end
+
+  always @(posedge clk) begin
+    if (reset) begin
+      u_valid <= 1'b0;
+      u_x_we <= 1'b0;
+      u_y_we <= 1'b0;
+    end else begin
+      u_valid <= d_valid;
+      u_l1_hit <= c_l1_hit;
+      u_l1_index <= d_l1_index;
+      u_a_tag <= a_tag;
+      u_a_valid <= a_valid;
+      u_a_dirty <= a_dirty;
+      u_a_repl <= a_repl;
+      u_x_we <= d_valid && x_we;
+      u_x_index <= x_index;
+      u_x_tag <= x_tag;
+      u_x_valid <= x_valid;
+      u_x_dirty <= x_dirty;
+      u_x_repl <= x_repl;
+      u_y_we <= d_valid && y_we;
+      u_y_index <= d_l2_index;
+      u_y_tag <= y_tag;
+      u_y_valid <= y_valid;
+      u_y_dirty <= y_dirty;
+      u_y_repl <= y_repl;
+      u_l1_read <= d_valid && !d_write;
+      u_l1_read_miss <= d_valid && !d_write && !c_l1_hit;
+      u_l1_write <= d_valid && d_write;
+      u_l1_write_miss <= d_valid && d_write && !c_l1_hit;
+      u_l1_write_back <= c_l1_write_back;
+      u_l2_read <= c_l2_read;
+      u_l2_read_miss <= c_l2_read_miss;
+      u_l2_write <= c_l2_write;
+      u_l2_write_miss <= c_l2_write_miss;
+      u_l2_write_backs <= c_l2_write_backs;
+      u_traffic <= c_traffic;
+    end
+  end
+
+  // Update stage, sets and counters take the access in
+  always @(posedge clk) begin
+    if (reset) begin
+      for (int s = 0; s < L1_NUMSETS; s++) begin
+        l1_valid[s] <= '0;
+        l1_dirty[s] <= '0;
+        l1_repl[s] <= l1_repl_reset();
+      end
+      for (int s = 0; s < L2_NUMSETS; s++) begin
+        l2_valid[s] <= '0;
+        l2_dirty[s] <= '0;
+        l2_repl[s] <= l2_repl_reset();
+      end
+      out_valid <= 1'b0;
+      out_l1_hit <= 1'b0;
+      L1_reads <= 32'b0;
+      L1_read_misses <= 32'b0;
+      L1_writes <= 32'b0;
+      L1_write_misses <= 32'b0;
+      L1_write_backs <= 32'b0;
+      L2_reads <= 32'b0;
+      L2_read_misses <= 32'b0;
+      L2_writes <= 32'b0;
+      L2_write_misses <= 32'b0;
+      L2_write_backs <= 32'b0;
+      memory_traffic <= 32'b0;
+      accesses <= 32'b0;
+      cycles <= 32'b0;
+    end else begin
+      out_valid <= u_valid;
+      out_l1_hit <= u_l1_hit;
+      if (in_valid || d_valid || u_valid) cycles <= cycles + 1;
+      if (u_valid) begin
+        l1_tag[u_l1_index] <= u_a_tag;
+        l1_valid[u_l1_index] <= u_a_valid;
+        l1_dirty[u_l1_index] <= u_a_dirty;
+        l1_repl[u_l1_index] <= u_a_repl;
+        accesses <= accesses + 1;
+        L1_reads <= L1_reads + u_l1_read;
+        L1_read_misses <= L1_read_misses + u_l1_read_miss;
+        L1_writes <= L1_writes + u_l1_write;
+        L1_write_misses <= L1_write_misses + u_l1_write_miss;
+        L1_write_backs <= L1_write_backs + u_l1_write_back;
+        L2_reads <= L2_reads + u_l2_read;
+        L2_read_misses <= L2_read_misses + u_l2_read_miss;
+        L2_writes <= L2_writes + u_l2_write;
+        L2_write_misses <= L2_write_misses + u_l2_write_miss;
+        L2_write_backs <= L2_write_backs + u_l2_write_backs;
+        memory_traffic <= memory_traffic + u_traffic;
+      end
+      if (u_x_we) begin
+        l2_tag[u_x_index] <= u_x_tag;
+        l2_valid[u_x_index] <= u_x_valid;
+        l2_dirty[u_x_index] <= u_x_dirty;
+        l2_repl[u_x_index] <= u_x_repl;
+      end
+      if (u_y_we) begin
+        l2_tag[u_y_index] <= u_y_tag;
+        l2_valid[u_y_index] <= u_y_valid;
+        l2_dirty[u_y_index] <= u_y_dirty;
+        l2_repl[u_y_index] <= u_y_repl;
+      end
+    end
+  end
+
+endmodule
@@ -11,4 +11,9 @@ parameter L1_NUMSETS = L1_CACHESIZE/(BLOCKSIZE * L1_ASSOC);
 parameter L2_CACHESIZE = 8192;
 parameter L2_ASSOC = 4;
 parameter L2_NUMSETS = L2_CACHESIZE/(BLOCKSIZE * L2_ASSOC);
+
+//Replacement state of cache_engine_pipe, 0 -> a recency rank per way, exact
+//LRU and FIFO | 1 -> assoc-1 tree pseudo-LRU bits per set, FIFO as a
+//round-robin pointer (needs power of 2 associativities)
+parameter PLRU = 0;
 `endif
\ No newline at end of file
@@ -0,0 +1,100 @@
+`timescale 1ns / 1ps
+`include "cache_params.vh"
+//////////////////////////////////////////////////////////////////////////////////
+// Company: UCF
+// Engineers: John Gierlach & Harrison Lipton
+//
+// Module Name: cache_pipe_tb
+// Project Name: Multi-level Cache project
+// Description: streams a trace into cache_engine_pipe one access per cycle
+//   and prints the counters and cycles per access at the end
+//////////////////////////////////////////////////////////////////////////////////
+
+module cache_pipe_tb();
+    reg clk, reset;
+    reg replace_policy, inclusion_policy;
+    reg in_valid;
+    wire in_ready;
+    reg[47:0] cache_addr;
+    reg[7:0] cache_op;
+    wire out_valid, out_l1_hit;
+    wire[31:0] L1_reads, L1_read_misses, L1_writes, L1_write_misses, L1_write_backs;
+    wire[31:0] L2_reads, L2_read_misses, L2_writes, L2_write_misses, L2_write_backs;
+    wire[31:0] memory_traffic, accesses, cycles;
+    parameter SIZE = 100000;
+    reg[47:0] test_addrs[0:SIZE-1];
+    reg[7:0] test_ops[0:SIZE-1];
+    integer i;
+
+    cache_engine_pipe UUT(
+        .clk(clk),
+        .reset(reset),
+        .replace_policy(replace_policy),
+        .inclusion_policy(inclusion_policy),
+        .in_valid(in_valid),
+        .in_ready(in_ready),
+        .cache_addr(cache_addr),
+        .cache_op(cache_op),
+        .out_valid(out_valid),
+        .out_l1_hit(out_l1_hit),
+        .L1_reads(L1_reads),
+        .L1_read_misses(L1_read_misses),
+        .L1_writes(L1_writes),
+        .L1_write_misses(L1_write_misses),
+        .L1_write_backs(L1_write_backs),
+        .L2_reads(L2_reads),
+        .L2_read_misses(L2_read_misses),
+        .L2_writes(L2_writes),
+        .L2_write_misses(L2_write_misses),
+        .L2_write_backs(L2_write_backs),
+        .memory_traffic(memory_traffic),
+        .accesses(accesses),
+        .cycles(cycles)
+        );
+
+    /*                                   SIMULATION INPUTS
+    ************************************************************************************************
+        replace_policy: 0 -> FIFO | 1 -> LRU
+
+        inclusion_policy: 0 -> inclusive | 1 -> non-inclusive
+    ************************************************************************************************
+    */
+    initial begin
+        $readmemh("traces/gcc_trace_addresses.txt", test_addrs, 0, SIZE-1);
+        $readmemh("traces/gcc_trace_actions.txt", test_ops, 0, SIZE-1);
+        replace_policy = 1;
+        inclusion_policy = 1;
+        in_valid = 0;
+        cache_addr = 0;
+        cache_op = 0;
+        clk = 0;
+        reset = 1;
+        #10
+        reset = 0;
+        // a new access every cycle the engine is ready for one
+        i = 0;
+        while (i < SIZE) begin
+            @(negedge clk);
+            in_valid = 1;
+            cache_addr = test_addrs[i];
+            cache_op = test_ops[i];
+            @(posedge clk);
+            if (in_ready) i = i + 1;
+        end
+        @(negedge clk);
+        in_valid = 0;
+        wait (accesses == SIZE);
+        @(negedge clk);
+
+        $display("L1 reads %0d read misses %0d writes %0d write misses %0d write backs %0d",
+                 L1_reads, L1_read_misses, L1_writes, L1_write_misses, L1_write_backs);
+        $display("L2 reads %0d read misses %0d writes %0d write misses %0d write backs %0d",
+                 L2_reads, L2_read_misses, L2_writes, L2_write_misses, L2_write_backs);
+        $display("memory traffic %0d, %0d accesses in %0d cycles, %f cycles per access",
+                 memory_traffic, accesses, cycles, $itor(cycles) / accesses);
+        $finish;
+    end
+
+    always #1 clk = ~clk;
+
+endmodule
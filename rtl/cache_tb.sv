@@ -29,8 +29,11 @@ module cache_tb();
     wire[17:0] L1_reads, L1_writes, L1_misses, L1_hits;
     wire[17:0] L2_reads, L2_writes, L2_misses, L2_hits;
     wire[31:0] curr_tag_L1, curr_tag_L2;
-    wire[31:0] cache1 [0:L1_NUMSETS-1][0:L1_ASSOC-1];
-    wire[31:0] cache2 [0:L2_NUMSETS-1][0:L2_ASSOC-1];
+    reg dbg_level;
+    reg[11:0] dbg_set;
+    reg[7:0] dbg_way;
+    wire[31:0] dbg_tag;
+    wire dbg_valid;
     parameter SIZE = 100000;
     reg[47:0] test_addrs[0:SIZE-1];
     reg[7:0] test_ops[0:SIZE-1];
@@ -58,8 +61,11 @@ module cache_tb();
         .curr_tag_L2(curr_tag_L2),
         .cache_op(cache_op),
         .curr_set_L1(curr_set_L1),
-        .L1_cache(cache1),
-        .L2_cache(cache2)
+        .dbg_level(dbg_level),
+        .dbg_set(dbg_set),
+        .dbg_way(dbg_way),
+        .dbg_tag(dbg_tag),
+        .dbg_valid(dbg_valid)
         );
     integer i;
     
@@ -75,8 +81,11 @@ module cache_tb();
     ************************************************************************************************   
     */
     initial begin
-        $readmemh("C:/Users/JohnG/Desktop/Codes/School/CDA5106/rtl/traces/gcc_trace_addresses.txt", test_addrs, 0, 99999);
-        $readmemh("C:/Users/JohnG/Desktop/Codes/School/CDA5106/rtl/traces/gcc_trace_actions.txt", test_ops, 0, 99999);
+        $readmemh("traces/gcc_trace_addresses.txt", test_addrs, 0, 99999);
+        $readmemh("traces/gcc_trace_actions.txt", test_ops, 0, 99999);
+        dbg_level = 0;
+        dbg_set = 0;
+        dbg_way = 0;
         replace_policy = 1;
         write_policy = 1;
         inclusion_policy = 1;
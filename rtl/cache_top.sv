@@ -36,8 +36,6 @@ module cache_top(
   // replace_policy: 0 -> FIFO | 1 -> LRU                                       DONE
   // inclusion_policy: 0 -> inclusive | 2 -> non-inclusive                      DONE
   // cache_op: W or R
-  reg[31:0] L1_cache [0:L1_NUMSETS-1][0:L1_ASSOC-1];
-  reg[31:0] L2_cache [0:L2_NUMSETS-1][0:L2_ASSOC-1];
   reg[31:0] L1_index;         
   reg[31:0] L1_tag;
   
@@ -59,15 +57,14 @@ module cache_top(
         .L2_writes(L2_writes),
         .L2_misses(L2_misses),
         .L2_hits(L2_hits),
-        .curr_tag(curr_tag),
         .cache_op(cache_op),
-        .curr_set(curr_set),
         .L1_index(L1_index),
         .L2_index(L2_index),
         .L1_tag(L1_tag),
         .L2_tag(L2_tag),
-        .L1_cache(L1_cache),
-        .L2_cache(L2_cache)
+        .dbg_level(1'b0),
+        .dbg_set(12'b0),
+        .dbg_way(8'b0)
    );
    
 endmodule
\ No newline at end of file
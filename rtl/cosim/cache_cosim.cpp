@@ -0,0 +1,517 @@
+// lockstep co-simulation of the verilated cache engine against the C model
+// in ../../sim through libcachesim. Every access of the trace goes into
+// both, and once the RTL has finished each one the counters and the tags of
+// every set are compared, the first difference is reported and ends the run.
+//   ./obj_dir/Vcache_engine [--policy LRU|FIFO] [--inclusion inclusive|non-inclusive] <trace_file>
+//   ./obj_pipe/Vcache_engine_pipe ...   the same for cache_engine_pipe
+// the trace is any trace cacheSim reads, text, packed, or - for stdin
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include "verilated.h"
+#ifdef PIPELINED
+#include "Vcache_engine_pipe.h"
+#include "Vcache_engine_pipe___024root.h"
+typedef Vcache_engine_pipe Rtl;
+#define RTL_NAME "Vcache_engine_pipe"
+#else
+#include "Vcache_engine.h"
+#include "Vcache_engine___024root.h"
+typedef Vcache_engine Rtl;
+#define RTL_NAME "Vcache_engine"
+#endif
+#include "libcachesim.h"
+extern "C" {
+#include "traceReader.h"
+}
+
+// cache_params.vh values, passed in by the Makefile
+#if defined(PIPELINED) && PLRU
+// the tree bits decide victims exactly as the C model's PLRU policy, but
+// sets hold no recency order, so their tags are compared as sorted sets
+#define RTL_PLRU 1
+#else
+#define RTL_PLRU 0
+#endif
+#define L1_NUMSETS (L1_CACHESIZE / (BLOCKSIZE * L1_ASSOC))
+#define L2_NUMSETS (L2_CACHESIZE / (BLOCKSIZE * L2_ASSOC))
+#define MAX_ASSOC (L1_ASSOC > L2_ASSOC ? L1_ASSOC : L2_ASSOC)
+
+// cache_op values the engines decode, ASCII R and W as in the tb traces
+#define OP_READ 0x52
+#define OP_WRITE 0x57
+// cycles an access may take before the RTL is taken to be hung
+#define ACCESS_TIMEOUT 64
+// the RTL latches 48 bit addresses, the C model's are cut the same way
+#define ADDRESS_BITS 48
+#define ADDRESS_MASK ((1ULL << ADDRESS_BITS) - 1)
+
+static void tick(Rtl *rtl)
+{
+    rtl->clk = 0;
+    rtl->eval();
+    rtl->clk = 1;
+    rtl->eval();
+}
+
+static unsigned long long lowBits(unsigned long long value, int width)
+{
+    return width >= 64 ? value : value & ((1ULL << width) - 1);
+}
+
+// bits [lo, lo + width) of a packed vector Verilator holds in a scalar
+template <typename T>
+static unsigned long long packedBits(const T &value, int lo, int width)
+{
+    return lowBits((unsigned long long)value >> lo, width);
+}
+
+// and of one it holds in 32 bit words
+template <std::size_t N>
+static unsigned long long packedBits(const VlWide<N> &value, int lo, int width)
+{
+    unsigned long long bits = 0;
+    for (int i = width - 1; i >= 0; i--)
+    {
+        bits = (bits << 1) | ((value[(lo + i) / 32] >> ((lo + i) % 32)) & 1);
+    }
+    return bits;
+}
+
+#ifdef PIPELINED
+static int log2Int(int x)
+{
+    int bits = 0;
+    while ((1 << bits) < x)
+    {
+        bits++;
+    }
+    return bits;
+}
+
+// valid tags of one set, most recent first, ordered by the way ranks the
+// engine keeps the same way the C model does, or in way order with PLRU
+template <typename Tags, typename Bits, typename Repl>
+static int rtlSetWays(const Tags &tags, const Bits &valid, const Repl &repl, int assoc, int tagBits,
+                      unsigned long long *got)
+{
+    int rankBits = assoc > 1 ? log2Int(assoc) : 1;
+    unsigned long long ranks[MAX_ASSOC];
+    int held = 0;
+    for (int way = 0; way < assoc; way++)
+    {
+        if (!packedBits(valid, way, 1))
+        {
+            continue;
+        }
+        unsigned long long tag = packedBits(tags, way * tagBits, tagBits);
+        unsigned long long wayRank = RTL_PLRU ? way : packedBits(repl, way * rankBits, rankBits);
+        int i = held++;
+        while (i > 0 && ranks[i - 1] > wayRank)
+        {
+            ranks[i] = ranks[i - 1];
+            got[i] = got[i - 1];
+            i--;
+        }
+        ranks[i] = wayRank;
+        got[i] = tag;
+    }
+    return held;
+}
+
+static int rtlSet(const Rtl *rtl, int level, int set, unsigned long long *got)
+{
+    const Vcache_engine_pipe___024root *root = rtl->rootp;
+    int offsetBits = log2Int(BLOCKSIZE);
+    if (level == 1)
+    {
+        return rtlSetWays(root->cache_engine_pipe__DOT__l1_tag[set], root->cache_engine_pipe__DOT__l1_valid[set],
+                          root->cache_engine_pipe__DOT__l1_repl[set], L1_ASSOC,
+                          ADDRESS_BITS - offsetBits - log2Int(L1_NUMSETS), got);
+    }
+    return rtlSetWays(root->cache_engine_pipe__DOT__l2_tag[set], root->cache_engine_pipe__DOT__l2_valid[set],
+                      root->cache_engine_pipe__DOT__l2_repl[set], L2_ASSOC,
+                      ADDRESS_BITS - offsetBits - log2Int(L2_NUMSETS), got);
+}
+
+// full width tags and 32 bit counters
+static int tagBits(int level)
+{
+    return ADDRESS_BITS - log2Int(BLOCKSIZE) - log2Int(level == 1 ? L1_NUMSETS : L2_NUMSETS);
+}
+#define COUNTER_BITS 32
+#else
+// valid tags of one FSM engine set in way order, the engine shifts the
+// newest block into way 0 and keeps 32 bit tags, way w in bits [32w, 32w + 32)
+// of the set's word and its valid bit at set * assoc + w
+template <typename Tags, typename Valid>
+static int rtlSetWays(const Tags &tags, const Valid &valid, int set, int assoc, unsigned long long *got)
+{
+    int held = 0;
+    for (int way = 0; way < assoc; way++)
+    {
+        if (packedBits(valid, set * assoc + way, 1))
+        {
+            got[held++] = packedBits(tags, way * 32, 32);
+        }
+    }
+    return held;
+}
+
+static int rtlSet(const Rtl *rtl, int level, int set, unsigned long long *got)
+{
+    const Vcache_engine___024root *root = rtl->rootp;
+    if (level == 1)
+    {
+        return rtlSetWays(root->cache_engine__DOT__L1_tags[set], root->cache_engine__DOT__L1_valid, set, L1_ASSOC,
+                          got);
+    }
+    return rtlSetWays(root->cache_engine__DOT__L2_tags[set], root->cache_engine__DOT__L2_valid, set, L2_ASSOC, got);
+}
+
+static int tagBits(int level)
+{
+    return 32;
+}
+#define COUNTER_BITS 18
+#endif
+
+static void printTags(const char *model, const unsigned long long *tags, int count)
+{
+    printf("  %-8s", model);
+    for (int i = 0; i < count; i++)
+    {
+        printf(" %llx", tags[i]);
+    }
+    printf(count == 0 ? " (empty)\n" : "\n");
+}
+
+static void sortTags(unsigned long long *tags, int count)
+{
+    for (int i = 1; i < count; i++)
+    {
+        unsigned long long tag = tags[i];
+        int j = i;
+        for (; j > 0 && tags[j - 1] > tag; j--)
+        {
+            tags[j] = tags[j - 1];
+        }
+        tags[j] = tag;
+    }
+}
+
+// compare the tags of one set, most recent first on both sides, or sorted
+// when the RTL keeps PLRU bits
+static int compareSet(const struct sim *model, const Rtl *rtl, int level, int set)
+{
+    uint64_t expected[MAX_ASSOC];
+    unsigned long long want[MAX_ASSOC];
+    unsigned long long got[MAX_ASSOC];
+    int wanted = sim_get_set(model, level, set, expected);
+    int held = rtlSet(rtl, level, set, got);
+    for (int i = 0; i < wanted; i++)
+    {
+        want[i] = lowBits(expected[i], tagBits(level));
+    }
+    if (RTL_PLRU)
+    {
+        sortTags(want, wanted);
+        sortTags(got, held);
+    }
+
+    int same = wanted == held;
+    for (int i = 0; same && i < held; i++)
+    {
+        same = want[i] == got[i];
+    }
+    if (same)
+    {
+        return 0;
+    }
+    printf("L%i set %i differs\n", level, set);
+    printTags("C model:", want, wanted);
+    printTags("RTL:", got, held);
+    return -1;
+}
+
+static int compareCounter(const char *name, unsigned long long expected, unsigned long long rtl)
+{
+    if (lowBits(expected, COUNTER_BITS) == rtl)
+    {
+        return 0;
+    }
+    printf("%s differs, C model %llu, RTL %llu\n", name, lowBits(expected, COUNTER_BITS), rtl);
+    return -1;
+}
+
+static int compareCounters(const struct sim *model, const Rtl *rtl)
+{
+    struct sim_stats stats;
+    sim_get_stats(model, &stats);
+    const struct sim_level_stats *l1 = &stats.level[0];
+    const struct sim_level_stats *l2 = &stats.level[1];
+#ifdef PIPELINED
+    return compareCounter("accesses", stats.accesses, rtl->accesses) |
+           compareCounter("L1_reads", l1->reads, rtl->L1_reads) |
+           compareCounter("L1_read_misses", l1->read_misses, rtl->L1_read_misses) |
+           compareCounter("L1_writes", l1->writes, rtl->L1_writes) |
+           compareCounter("L1_write_misses", l1->write_misses, rtl->L1_write_misses) |
+           compareCounter("L1_write_backs", l1->write_backs, rtl->L1_write_backs) |
+           compareCounter("L2_reads", l2->reads, rtl->L2_reads) |
+           compareCounter("L2_read_misses", l2->read_misses, rtl->L2_read_misses) |
+           compareCounter("L2_writes", l2->writes, rtl->L2_writes) |
+           compareCounter("L2_write_misses", l2->write_misses, rtl->L2_write_misses) |
+           compareCounter("L2_write_backs", l2->write_backs, rtl->L2_write_backs) |
+           compareCounter("memory_traffic", stats.memory_traffic, rtl->memory_traffic);
+#else
+    // the FSM engine bumps L1_reads and L2_reads on misses only, so the
+    // counters both models define the same way, hits and misses, are compared
+    unsigned long long l1Misses = l1->read_misses + l1->write_misses;
+    return compareCounter("L1_misses", l1Misses, rtl->L1_misses) |
+           compareCounter("L1_hits", l1->reads + l1->writes - l1Misses, rtl->L1_hits) |
+           compareCounter("L2_misses", l2->read_misses, rtl->L2_misses) |
+           compareCounter("L2_hits", l2->reads - l2->read_misses, rtl->L2_hits);
+#endif
+}
+
+static int compareModels(const struct sim *model, const Rtl *rtl)
+{
+    int status = compareCounters(model, rtl);
+    for (int set = 0; set < L1_NUMSETS; set++)
+    {
+        status |= compareSet(model, rtl, 1, set);
+    }
+    for (int set = 0; set < L2_NUMSETS; set++)
+    {
+        status |= compareSet(model, rtl, 2, set);
+    }
+    return status;
+}
+
+static void reportDivergence(size_t access, int operation, unsigned long long address)
+{
+    printf("first divergence at access %zu (%c %llx)\n", access, operation == 1 ? 'w' : 'r', address);
+}
+
+#ifdef PIPELINED
+// accesses the engine has taken but not yet written back
+#define IN_FLIGHT 8
+
+// issue an access every cycle the engine is ready and check each one as it
+// comes out of the update stage, returns the exit status
+static int runLockstep(Rtl *rtl, struct sim *model, TraceReader *reader)
+{
+    unsigned long long addresses[IN_FLIGHT];
+    int operations[IN_FLIGHT];
+    size_t issued = 0;
+    size_t retired = 0;
+    int ended = 0;
+    int idle = 0;
+    while (!ended || retired < issued)
+    {
+        int operation;
+        unsigned long long address;
+        rtl->in_valid = 0;
+        if (!ended && issued - retired < IN_FLIGHT && rtl->in_ready)
+        {
+            if (nextAccess(reader, &operation, &address))
+            {
+                address &= ADDRESS_MASK;
+                addresses[issued % IN_FLIGHT] = address;
+                operations[issued % IN_FLIGHT] = operation;
+                issued++;
+                rtl->in_valid = 1;
+                rtl->cache_addr = address;
+                rtl->cache_op = operation == 1 ? OP_WRITE : OP_READ;
+            }
+            else
+            {
+                ended = 1;
+            }
+        }
+        tick(rtl);
+        if (!rtl->out_valid)
+        {
+            if (++idle > ACCESS_TIMEOUT)
+            {
+                printf("access %zu: RTL wrote nothing back for %i cycles\n", retired + 1, ACCESS_TIMEOUT);
+                return 1;
+            }
+            continue;
+        }
+        idle = 0;
+        uint64_t address64 = addresses[retired % IN_FLIGHT];
+        uint8_t operation8 = operations[retired % IN_FLIGHT];
+        sim_access_batch(model, &address64, &operation8, 1);
+        retired++;
+        if (compareModels(model, rtl) != 0)
+        {
+            reportDivergence(retired, operation8, address64);
+            return 1;
+        }
+    }
+    rtl->in_valid = 0;
+
+    printf("%zu accesses in %u cycles, %.3f cycles per access, RTL matches the C model\n", retired,
+           (unsigned)rtl->cycles, retired == 0 ? 0.0 : (double)rtl->cycles / rtl->accesses);
+    printf("L1 read misses %u write misses %u, L2 read misses %u write misses %u, memory traffic %u\n",
+           (unsigned)rtl->L1_read_misses, (unsigned)rtl->L1_write_misses, (unsigned)rtl->L2_read_misses,
+           (unsigned)rtl->L2_write_misses, (unsigned)rtl->memory_traffic);
+    return 0;
+}
+#else
+// the engine's IDLE state, an access runs IDLE READ SEARCH <update> DONE
+#define STATE_IDLE 0
+
+// run one access through the FSM, returns the cycles it took or -1 if the
+// engine never came back to IDLE
+static int rtlAccess(Rtl *rtl, int operation, unsigned long long address)
+{
+    rtl->cache_addr = address;
+    rtl->cache_op = operation == 1 ? OP_WRITE : OP_READ;
+    for (int cycles = 1; cycles <= ACCESS_TIMEOUT; cycles++)
+    {
+        tick(rtl);
+        if (rtl->rootp->cache_engine__DOT__state == STATE_IDLE)
+        {
+            return cycles;
+        }
+    }
+    return -1;
+}
+
+static int runLockstep(Rtl *rtl, struct sim *model, TraceReader *reader)
+{
+    int operation;
+    unsigned long long address;
+    size_t accesses = 0;
+    size_t skipped = 0;
+    unsigned long long cycles = 0;
+    while (nextAccess(reader, &operation, &address))
+    {
+        address &= ADDRESS_MASK;
+        // the engine idles on address 0, so neither model sees it
+        if (address == 0)
+        {
+            skipped++;
+            continue;
+        }
+        int taken = rtlAccess(rtl, operation, address);
+        uint64_t address64 = address;
+        uint8_t operation8 = operation;
+        sim_access_batch(model, &address64, &operation8, 1);
+        accesses++;
+        if (taken < 0)
+        {
+            printf("access %zu (%c %llx): RTL did not return to IDLE within %i cycles\n", accesses,
+                   operation == 1 ? 'w' : 'r', address, ACCESS_TIMEOUT);
+            return 1;
+        }
+        cycles += taken;
+        if (compareModels(model, rtl) != 0)
+        {
+            reportDivergence(accesses, operation, address);
+            return 1;
+        }
+    }
+
+    printf("%zu accesses in %llu cycles, %.3f cycles per access, RTL matches the C model\n", accesses, cycles,
+           accesses == 0 ? 0.0 : (double)cycles / accesses);
+    printf("L1 hits %u misses %u, L2 hits %u misses %u\n", (unsigned)rtl->L1_hits, (unsigned)rtl->L1_misses,
+           (unsigned)rtl->L2_hits, (unsigned)rtl->L2_misses);
+    if (skipped > 0)
+    {
+        printf("%zu accesses to address 0 were skipped\n", skipped);
+    }
+    return 0;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    int policy = SIM_POLICY_LRU;
+    int inclusion = SIM_NON_INCLUSIVE;
+    const char *tracePath = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc)
+        {
+            i++;
+            policy = strcmp(argv[i], "FIFO") == 0 ? SIM_POLICY_FIFO : strcmp(argv[i], "LRU") == 0 ? SIM_POLICY_LRU : -1;
+        }
+        else if (strcmp(argv[i], "--inclusion") == 0 && i + 1 < argc)
+        {
+            i++;
+            inclusion = strcmp(argv[i], "inclusive") == 0 ? SIM_INCLUSIVE : strcmp(argv[i], "non-inclusive") == 0 ? SIM_NON_INCLUSIVE : -1;
+        }
+        else if (argv[i][0] == '+')
+        {
+            // +verilator+ arguments are left to the context
+            continue;
+        }
+        else
+        {
+            tracePath = argv[i];
+        }
+    }
+    if (tracePath == NULL || policy < 0 || inclusion < 0)
+    {
+        printf("Usage: ./" RTL_NAME " [--policy LRU|FIFO] [--inclusion inclusive|non-inclusive] <trace_file>\n");
+        return 1;
+    }
+
+    // replace_policy 1 is LRU and inclusion_policy 0 is inclusive
+    int rtlLru = policy == SIM_POLICY_LRU;
+    if (RTL_PLRU && policy == SIM_POLICY_FIFO && inclusion == SIM_INCLUSIVE)
+    {
+        // the round-robin pointer stays put when a fill takes a way that
+        // back-invalidation emptied, where FIFO ranks make that way the
+        // newest, so only non-inclusive FIFO has an exact C counterpart
+        printf("PLRU build: round-robin FIFO is not modelled with back-invalidation, skipped\n");
+        return 0;
+    }
+    if (RTL_PLRU && policy == SIM_POLICY_LRU)
+    {
+        policy = SIM_POLICY_PLRU;
+    }
+
+    struct sim_config config = {BLOCKSIZE, L1_CACHESIZE, L1_ASSOC, L2_CACHESIZE, L2_ASSOC, policy, inclusion};
+    struct sim *model = sim_create(&config);
+    if (model == NULL)
+    {
+        printf("cache_params.vh does not describe a cache the C model can build\n");
+        return 1;
+    }
+    TraceReader reader;
+    if (openTrace(&reader, tracePath) != 0)
+    {
+        printf("Could not open file.\n");
+        sim_destroy(model);
+        return 1;
+    }
+
+    std::unique_ptr<VerilatedContext> context{new VerilatedContext};
+    context->commandArgs(argc, argv);
+    std::unique_ptr<Rtl> rtl{new Rtl{context.get()}};
+    rtl->replace_policy = rtlLru;
+    rtl->inclusion_policy = inclusion == SIM_NON_INCLUSIVE;
+#ifdef PIPELINED
+    rtl->in_valid = 0;
+#else
+    // write-back, the C model's only write policy
+    rtl->write_policy = 1;
+#endif
+    rtl->cache_addr = 0;
+    rtl->reset = 1;
+    tick(rtl.get());
+    tick(rtl.get());
+    rtl->reset = 0;
+
+    int status = runLockstep(rtl.get(), model, &reader);
+    rtl->final();
+    closeTrace(&reader);
+    sim_destroy(model);
+    return status;
+}
@@ -0,0 +1,32 @@
+# Out-of-context synthesis of cache_engine_pipe with recency ranks (PLRU = 0)
+# and with tree pseudo-LRU bits (PLRU = 1), everything else as cache_params.vh
+# has it, to compare the utilization and timing of the two
+#   vivado -mode batch -source synth_pipe.tcl [-tclargs <part> <clock period ns>]
+# reports land in synth_pipe/plru0 and synth_pipe/plru1
+
+set part [expr {$argc > 0 ? [lindex $argv 0] : "xc7a35tcpg236-1"}]
+set period [expr {$argc > 1 ? [lindex $argv 1] : 10.0}]
+set here [file dirname [file normalize [info script]]]
+
+set file [open $here/cache_params.vh]
+set params [read $file]
+close $file
+
+foreach plru {0 1} {
+  # the parameters sit outside the module, so each run gets its own copy
+  set out $here/synth_pipe/plru$plru
+  file mkdir $out
+  regsub {parameter PLRU = [0-9]+;} $params "parameter PLRU = $plru;" variant
+  set file [open $out/cache_params.vh w]
+  puts -nonewline $file $variant
+  close $file
+  file copy -force $here/cache_engine_pipe.sv $out
+
+  create_project -in_memory -part $part
+  read_verilog -sv $out/cache_engine_pipe.sv
+  synth_design -top cache_engine_pipe -part $part -mode out_of_context -include_dirs $out
+  create_clock -name clk -period $period [get_ports clk]
+  report_utilization -file $out/utilization.rpt
+  report_timing_summary -max_paths 10 -file $out/timing.rpt
+  close_project
+}
@@ -0,0 +1,884 @@
+// the cache model itself, driven one access at a time by simulateAccess
+#include <stdlib.h>
+#include <string.h>
+#include "cacheEngine.h"
+#include "policy.h"
+#include "estimate.h"
+#ifdef LEAK_DETECT
+#include "leak_detector_c.h"
+unsigned long long ALLOCATION_COUNT = 0;
+#endif
+
+void evictWay(Simulator *sim, int currentLevel, int set, int way);
+void backInvalidate(Simulator *sim, int currentLevel, unsigned long long address);
+void accessLevel(Simulator *sim, int currentLevel, int operation, Block *block);
+void decodeAccess(Simulator *sim, int operation, unsigned long long int address, Block *blocks);
+int selectOptimalVictim(Simulator *sim, CacheLevel *cache, int set);
+void heapInsert(CacheLevel *cache, int set, int way);
+void heapRemove(CacheLevel *cache, int set, int way);
+void heapUpdate(CacheLevel *cache, int set, int way);
+static int fillWay(Simulator *sim, int currentLevel, int operation, Block *block);
+static void runPrefetcher(Simulator *sim, int currentLevel, Block *block);
+static void writeBackBlock(Simulator *sim, int currentLevel, unsigned long long address, size_t nextUse);
+static void keepVictim(Simulator *sim, unsigned long long address, int dirty);
+static int takeVictim(Simulator *sim, unsigned long long block, int prefetch);
+static bool forwardBuffered(Simulator *sim, unsigned long long block, int prefetch);
+static void dropBuffered(Simulator *sim, unsigned long long address);
+
+// function to check if a number is a power of 2
+bool isPowerOfTwo(int x) {
+    // 8 is 1000
+    // 7 is 0111,
+    // so 8 & 7 = 0
+
+    // 7 is 0111
+    // 6 is 0110
+    // so 7 & 6 = 6 or essentiall not 0
+
+    return !(x & (x - 1));
+}
+
+// exponent of a power of 2, integer only so level setup needs no libm
+int log2Int(int x) {
+    int bits = 0;
+    while ((1 << bits) < x) {
+        bits++;
+    }
+    return bits;
+}
+
+// pick the set groups a set sampled run keeps, a multiplicative hash of the
+// shared index bits is a permutation of them, so exactly 1 in setSampling
+// groups falls under the cut and they are spread over the index space, then
+// number the sets of those groups in every level
+static int sampleSets(Simulator *sim, int *setSlots[]){
+    int sharedSets = sim->numSets[0];
+    for (int i = 1; i < sim->totalLevels; i++){
+        if(sim->numSets[i] < sharedSets){
+            sharedSets = sim->numSets[i];
+        }
+    }
+    int rate = sim->config.setSampling;
+    if(!isPowerOfTwo(rate) || rate > sharedSets){
+        return -1;
+    }
+
+    sim->sharedMask = sharedSets - 1;
+    sim->numGroups = sharedSets;
+    sim->sampledGroups = sharedSets / rate;
+    sim->groupOf = malloc(sharedSets * sizeof(int));
+    sim->groups = calloc(sim->sampledGroups, sizeof(Sample));
+    int next = 0;
+    for (int shared = 0; shared < sharedSets; shared++){
+        unsigned int hashed = (shared * 0x9e3779b1u) & sim->sharedMask;
+        sim->groupOf[shared] = hashed < (unsigned int)sim->sampledGroups ? next++ : -1;
+    }
+
+    for (int i = 0; i < sim->totalLevels; i++){
+        setSlots[i] = malloc(sim->numSets[i] * sizeof(int));
+        int slot = 0;
+        for (int set = 0; set < sim->numSets[i]; set++){
+            setSlots[i][set] = sim->groupOf[set & sim->sharedMask] >= 0 ? slot++ : -1;
+        }
+    }
+    return 0;
+}
+
+// size both levels for config, returns 0 or SIM_BAD_L1_SETS/SIM_BAD_L2_SETS
+// in which case nothing was allocated
+int createSimulator(Simulator *sim, const SimConfig *config){
+    memset(sim, 0, sizeof(*sim));
+    sim->config = *config;
+
+    for (int i = 0; i < MAX_LEVELS; i++){
+        // avoid divide by zero error if associativity is 0
+        sim->numSets[i] = config->associativity[i] <= 0 ? 0 : config->cacheSize[i] / (config->associativity[i] * config->blockSize);
+    }
+    if (!isPowerOfTwo(sim->numSets[0])){
+        return SIM_BAD_L1_SETS;
+    }
+    if (!isPowerOfTwo(sim->numSets[1])){
+        return SIM_BAD_L2_SETS;
+    }
+    if(config->replacementPolicy == POLICY_PLRU){
+        for (int i = 0; i < MAX_LEVELS; i++){
+            if(sim->numSets[i] > 0 && (!isPowerOfTwo(config->associativity[i]) || config->associativity[i] > 64)){
+                return SIM_BAD_PLRU_WAYS;
+            }
+        }
+    }
+
+    if(sim->numSets[1] > 0 && sim->numSets[0] > 0){
+        sim->totalLevels = 2;
+    }else{
+        sim->totalLevels = 1;
+    }
+    if(config->victimEntries < 0 || config->victimEntries > MAX_BUFFER_ENTRIES ||
+       config->writeBackEntries < 0 || config->writeBackEntries > MAX_BUFFER_ENTRIES ||
+       ((config->victimEntries > 0 || config->writeBackEntries > 0) &&
+        (config->replacementPolicy == POLICY_OPTIMAL || config->setSampling > 1))){
+        return SIM_BAD_BUFFERS;
+    }
+    for (int i = 0; i < sim->totalLevels; i++){
+        if(config->prefetcher[i] == PREFETCH_NONE){
+            continue;
+        }
+        if(config->replacementPolicy == POLICY_OPTIMAL || config->setSampling > 1 ||
+           config->prefetchDegree[i] < 1 || config->prefetchDegree[i] > MAX_PREFETCH_DEGREE || config->prefetchDistance[i] < 1){
+            return SIM_BAD_PREFETCH;
+        }
+    }
+
+    int *setSlots[MAX_LEVELS] = {NULL, NULL};
+    if(config->setSampling > 1){
+        if(sampleSets(sim, setSlots) != 0){
+            return SIM_BAD_SET_SAMPLING;
+        }
+    }
+    for (int i = 0; i < MAX_LEVELS; i++){
+        sim->levels[i] = createCacheLevel(i + 1, config->cacheSize[i], config->associativity[i], sim->numSets[i], config->blockSize, config->replacementPolicy, setSlots[i]);
+    }
+    for (int i = 0; i < sim->totalLevels; i++){
+        if(config->prefetcher[i] != PREFETCH_NONE){
+            CacheLevel *cache = sim->levels[i];
+            cache->prefetched = (unsigned char *)calloc(cache->storedSets * cache->associativity, sizeof(unsigned char));
+            sim->prefetchers[i] = createPrefetcher(config->prefetcher[i], config->prefetchDegree[i], config->prefetchDistance[i]);
+        }
+    }
+    if(config->victimEntries > 0){
+        sim->victims = (BlockBuffer *)calloc(1, sizeof(BlockBuffer));
+        sim->victims->capacity = config->victimEntries;
+    }
+    if(config->writeBackEntries > 0){
+        sim->writeBackBuffer = (BlockBuffer *)calloc(1, sizeof(BlockBuffer));
+        sim->writeBackBuffer->capacity = config->writeBackEntries;
+    }
+#ifdef MISS_CLASSES
+    for (int i = 0; i < sim->totalLevels; i++){
+        CacheLevel *cache = sim->levels[i];
+        sim->profiles[i] = createMissProfile(cache->storedSets, cache->storedSets * cache->associativity);
+    }
+#endif
+    return 0;
+}
+
+void freeSimulator(Simulator *sim){
+    for (int i = 0; i < MAX_LEVELS; i++){
+        if(sim->levels[i] != NULL){
+            freeCacheLevel(sim->levels[i]);
+            sim->levels[i] = NULL;
+        }
+        if(sim->prefetchers[i] != NULL){
+            freePrefetcher(sim->prefetchers[i]);
+            sim->prefetchers[i] = NULL;
+        }
+#ifdef MISS_CLASSES
+        if(sim->profiles[i] != NULL){
+            freeMissProfile(sim->profiles[i]);
+            sim->profiles[i] = NULL;
+        }
+#endif
+    }
+    free(sim->groupOf);
+    free(sim->groups);
+    free(sim->victims);
+    free(sim->writeBackBuffer);
+    sim->groupOf = NULL;
+    sim->groups = NULL;
+    sim->victims = NULL;
+    sim->writeBackBuffer = NULL;
+}
+
+// reverse pass over the trace remembering where each block was seen last,
+// blocks are found through an open addressing table sized to twice the trace
+size_t *buildNextUse(const unsigned long long *addresses, size_t length, int blockSize){
+    int offsetBits = log2Int(blockSize);
+    size_t capacity = 16;
+    while (capacity < length * 2){
+        capacity *= 2;
+    }
+    size_t *nextUse = malloc(length * sizeof(size_t));
+    unsigned long long *blocks = malloc(capacity * sizeof(unsigned long long));
+    size_t *seen = malloc(capacity * sizeof(size_t));
+    if(nextUse == NULL || blocks == NULL || seen == NULL){
+        free(nextUse);
+        free(blocks);
+        free(seen);
+        return NULL;
+    }
+    for (size_t i = 0; i < capacity; i++){
+        seen[i] = NEVER_USED;
+    }
+
+    for (size_t i = length; i-- > 0;){
+        unsigned long long block = addresses[i] >> offsetBits;
+        size_t slot = (block * 0x9e3779b97f4a7c15ULL) & (capacity - 1);
+        while (seen[slot] != NEVER_USED && blocks[slot] != block){
+            slot = (slot + 1) & (capacity - 1);
+        }
+        nextUse[i] = seen[slot];
+        blocks[slot] = block;
+        seen[slot] = i;
+    }
+    free(blocks);
+    free(seen);
+    return nextUse;
+}
+
+// set sampling, accesses to groups that are not sampled only move the
+// trace position and the rest are charged to their group as well
+static void simulateSampledAccess(Simulator *sim, int operation, unsigned long long address){
+    int group = sim->groupOf[(address >> sim->levels[0]->offsetBits) & sim->sharedMask];
+    if(group < 0){
+        sim->position++;
+        return;
+    }
+    SimStats before = sim->stats;
+    Block blockAddress[MAX_LEVELS];
+    decodeAccess(sim, operation, address, blockAddress);
+    size_t nextUse = sim->nextUse != NULL ? sim->nextUse[sim->position] : NEVER_USED;
+    for (int i = 0; i < sim->totalLevels; i++){
+        blockAddress[i].nextUse = nextUse;
+    }
+    accessLevel(sim, 0, operation, blockAddress);
+    sim->position++;
+    addSampleDelta(&sim->groups[group], &sim->stats, &before);
+}
+
+// steady state path, the access is decoded on the stack and every cache
+// structure was sized by createSimulator, so nothing here touches the heap
+void simulateAccess(Simulator *sim, int operation, unsigned long long address){
+    if(sim->groupOf != NULL){
+        simulateSampledAccess(sim, operation, address);
+        return;
+    }
+    Block blockAddress[MAX_LEVELS];
+    decodeAccess(sim, operation, address, blockAddress);
+    size_t nextUse = sim->nextUse != NULL ? sim->nextUse[sim->position] : NEVER_USED;
+    for (int i = 0; i < sim->totalLevels; i++){
+        blockAddress[i].nextUse = nextUse;
+    }
+    accessLevel(sim, 0, operation, blockAddress);
+    sim->position++;
+    if(sim->victims != NULL){
+        sim->stats.victimOccupancy += sim->victims->count;
+    }
+    if(sim->writeBackBuffer != NULL){
+        sim->stats.writeBackOccupancy += sim->writeBackBuffer->count;
+    }
+}
+
+void finishSimulation(Simulator *sim){
+    SimStats *stats = &sim->stats;
+    // calculate miss rates, L2 only sees L1 misses so its rate is over reads
+    if(stats->reads[0] + stats->writes[0] == 0){
+        stats->missRate[0] = 0;
+    }else{
+        stats->missRate[0] = (double)(stats->readMisses[0] + stats->writeMisses[0]) / (stats->reads[0] + stats->writes[0]);
+    }
+    if(stats->reads[1] == 0){
+        stats->missRate[1] = 0;
+    }else{
+        stats->missRate[1] = (double)stats->readMisses[1] / stats->reads[1];
+    }
+}
+
+// linear scan of one set for the block's tag, returns the way or -1 on a miss
+// no early exit so the compare loop vectorizes for wide sets
+int findWay(CacheLevel *cache, Block *block){
+    unsigned long long *tags = &cache->tags[block->index * cache->associativity];
+    int hitWay = -1;
+    for (int way = 0; way < cache->associativity; way++){
+        if(tags[way] == block->tag){
+            hitWay = way;
+        }
+    }
+    return hitWay;
+}
+
+// first empty way of the set, otherwise the way ranked last, or the
+// policy's own choice when it has one
+int selectVictim(CacheLevel *cache, int set){
+    int base = set * cache->associativity;
+    // policies with their own victim only need the empty ways looked for
+    if(cache->policy->selectVictim != NULL){
+        for (int way = 0; way < cache->associativity; way++){
+            if(cache->tags[base + way] == INVALID_TAG){
+                return way;
+            }
+        }
+        return cache->policy->selectVictim(cache, set);
+    }
+    int victim = 0;
+    for (int way = 0; way < cache->associativity; way++){
+        if(cache->tags[base + way] == INVALID_TAG){
+            return way;
+        }
+        if(cache->rank[base + way] > cache->rank[base + victim]){
+            victim = way;
+        }
+    }
+    return victim;
+}
+
+// walk from the root to a leaf following the tree bits
+int plruVictim(CacheLevel *cache, int set){
+    unsigned long long bits = cache->plru[set];
+    int node = 1;
+    while(node < cache->associativity){
+        node = 2 * node + (int)((bits >> (node - 1)) & 1);
+    }
+    return node - cache->associativity;
+}
+
+// point every node on the way's path at the other half of its subtree
+void plruTouch(CacheLevel *cache, int set, int way){
+    unsigned long long bits = cache->plru[set];
+    for (int node = cache->associativity + way; node > 1; node >>= 1){
+        unsigned long long mask = 1ULL << ((node >> 1) - 1);
+        bits = (node & 1) ? bits & ~mask : bits | mask;
+    }
+    cache->plru[set] = bits;
+}
+
+// Belady's choice, the first empty way or the block used furthest in the
+// future. Keys of lower level blocks go stale when the block is reused
+// through a hit above, and a stale key only ever underestimates, so the top
+// is walked forward along the next use chain until it is current.
+int selectOptimalVictim(Simulator *sim, CacheLevel *cache, int set){
+    int base = set * cache->associativity;
+    if(cache->heapCount[set] < cache->associativity){
+        return selectVictim(cache, set);
+    }
+    while (1){
+        int top = cache->heap[base];
+        size_t key = cache->nextUse[base + top];
+        if(key == NEVER_USED || key > sim->position){
+            return top;
+        }
+        while (key != NEVER_USED && key <= sim->position){
+            key = sim->nextUse[key];
+        }
+        cache->nextUse[base + top] = key;
+        heapUpdate(cache, set, top);
+    }
+}
+
+static void heapSwap(CacheLevel *cache, int base, int a, int b){
+    unsigned short way = cache->heap[base + a];
+    cache->heap[base + a] = cache->heap[base + b];
+    cache->heap[base + b] = way;
+    cache->heapIndex[base + cache->heap[base + a]] = a;
+    cache->heapIndex[base + cache->heap[base + b]] = b;
+}
+
+// true when heap entry a should sit above b, the block used furthest away
+// first and among blocks never used again the lowest way, which is the
+// choice behind sim/validation_runs
+static bool heapAbove(CacheLevel *cache, int base, int a, int b){
+    int wayA = base + cache->heap[base + a];
+    int wayB = base + cache->heap[base + b];
+    if(cache->nextUse[wayA] != cache->nextUse[wayB]){
+        return cache->nextUse[wayA] > cache->nextUse[wayB];
+    }
+    return wayA < wayB;
+}
+
+// restore the max-heap around heap entry i after its key moved either way
+static void heapFix(CacheLevel *cache, int set, int i){
+    int base = set * cache->associativity;
+    int count = cache->heapCount[set];
+    while (i > 0 && heapAbove(cache, base, i, (i - 1) / 2)){
+        heapSwap(cache, base, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    while (1){
+        int largest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if(left < count && heapAbove(cache, base, left, largest)){
+            largest = left;
+        }
+        if(right < count && heapAbove(cache, base, right, largest)){
+            largest = right;
+        }
+        if(largest == i){
+            return;
+        }
+        heapSwap(cache, base, i, largest);
+        i = largest;
+    }
+}
+
+void heapInsert(CacheLevel *cache, int set, int way){
+    int base = set * cache->associativity;
+    int i = cache->heapCount[set]++;
+    cache->heap[base + i] = way;
+    cache->heapIndex[base + way] = i;
+    heapFix(cache, set, i);
+}
+
+void heapRemove(CacheLevel *cache, int set, int way){
+    int base = set * cache->associativity;
+    int i = cache->heapIndex[base + way];
+    int last = --cache->heapCount[set];
+    if(i != last){
+        heapSwap(cache, base, i, last);
+        heapFix(cache, set, i);
+    }
+}
+
+void heapUpdate(CacheLevel *cache, int set, int way){
+    heapFix(cache, set, cache->heapIndex[set * cache->associativity + way]);
+}
+
+// make way the most recent in its set, everything ranked ahead of it ages by one
+// PLRU keeps the ranks too, they only order the set for reports
+void promoteWay(CacheLevel *cache, int set, int way){
+    unsigned short *rank = &cache->rank[set * cache->associativity];
+    unsigned short current = rank[way];
+    for (int i = 0; i < cache->associativity; i++){
+        rank[i] += rank[i] < current;
+    }
+    rank[way] = 0;
+    if(cache->plru != NULL){
+        plruTouch(cache, set, way);
+    }
+}
+
+// rebuild the byte address of the block held in a way
+unsigned long long wayAddress(CacheLevel *cache, int slot, int way){
+    unsigned long long tag = cache->tags[slot * cache->associativity + way];
+    int set = cache->slotSet != NULL ? cache->slotSet[slot] : slot;
+    return ((tag << cache->indexBits) | (unsigned long long)set) << cache->offsetBits;
+}
+
+// drop the block in a way, writing it back to the next level or memory if dirty
+void evictWay(Simulator *sim, int currentLevel, int set, int way){
+    CacheLevel *cache = sim->levels[currentLevel];
+    int slot = set * cache->associativity + way;
+    unsigned long long address = wayAddress(cache, set, way);
+    int dirty = cache->dirty[slot];
+
+    if(cache->heap != NULL){
+        heapRemove(cache, set, way);
+    }
+    if(cache->prefetched != NULL && cache->prefetched[slot]){
+        sim->stats.uselessPrefetches[currentLevel] += 1;
+        cache->prefetched[slot] = 0;
+    }
+    cache->tags[slot] = INVALID_TAG;
+    cache->dirty[slot] = 0;
+#ifdef MISS_CLASSES
+    profileEviction(sim->profiles[currentLevel], set);
+#endif
+
+    if(currentLevel == 0 && sim->victims != NULL){
+        // the victim cache takes clean and dirty blocks alike
+        keepVictim(sim, address, dirty);
+    }else if (dirty == 1) {
+        writeBackBlock(sim, currentLevel, address, cache->heap != NULL ? cache->nextUse[slot] : NEVER_USED);
+    }
+
+    // an inclusive lower level takes its victims out of the levels above it
+    if(sim->config.inclusionProperty == 1 && currentLevel > 0){
+        backInvalidate(sim, currentLevel - 1, address);
+    }
+}
+
+// write a dirty block to the level below, or memory at the bottom
+static void writeBelow(Simulator *sim, int currentLevel, unsigned long long address, size_t nextUse){
+    // if we are not at the bottom level
+    if(currentLevel + 1 < sim->totalLevels){
+        Block lower;
+        decodeAddress(sim, currentLevel + 1, 1, address, &lower);
+        lower.nextUse = nextUse;
+        accessLevel(sim, currentLevel + 1, 1, &lower);
+    }else{
+        // update access traffic to memory
+        sim->stats.memoryTraffic += 1;
+    }
+}
+
+static int bufferFind(BlockBuffer *buffer, unsigned long long block){
+    for (int i = 0; i < buffer->count; i++){
+        if(buffer->blocks[i] == block){
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void bufferRemove(BlockBuffer *buffer, int i){
+    buffer->count--;
+    memmove(&buffer->blocks[i], &buffer->blocks[i + 1], (buffer->count - i) * sizeof(buffer->blocks[0]));
+    memmove(&buffer->dirty[i], &buffer->dirty[i + 1], (buffer->count - i) * sizeof(buffer->dirty[0]));
+}
+
+// insert at the front, the caller makes room
+static void bufferPush(BlockBuffer *buffer, unsigned long long block, int dirty){
+    memmove(&buffer->blocks[1], &buffer->blocks[0], buffer->count * sizeof(buffer->blocks[0]));
+    memmove(&buffer->dirty[1], &buffer->dirty[0], buffer->count * sizeof(buffer->dirty[0]));
+    buffer->blocks[0] = block;
+    buffer->dirty[0] = dirty;
+    buffer->count++;
+}
+
+// a dirty block leaves a level, L1's coalesce in the write-back buffer when
+// there is one and the oldest buffered block drains to make room
+static void writeBackBlock(Simulator *sim, int currentLevel, unsigned long long address, size_t nextUse){
+    sim->stats.writeBacks[currentLevel] += 1;
+    BlockBuffer *buffer = sim->writeBackBuffer;
+    if(currentLevel > 0 || buffer == NULL){
+        writeBelow(sim, currentLevel, address, nextUse);
+        return;
+    }
+    int offsetBits = sim->levels[0]->offsetBits;
+    unsigned long long block = address >> offsetBits;
+    if(bufferFind(buffer, block) >= 0){
+        sim->stats.writeBackCoalesced += 1;
+        return;
+    }
+    // the buffer is consistent before the drain, which may back-invalidate
+    if(buffer->count == buffer->capacity){
+        unsigned long long oldest = buffer->blocks[--buffer->count];
+        bufferPush(buffer, block, 1);
+        sim->stats.writeBackDrains += 1;
+        writeBelow(sim, 0, oldest << offsetBits, NEVER_USED);
+        return;
+    }
+    bufferPush(buffer, block, 1);
+}
+
+// an L1 victim enters the victim cache, pushing its least recent block out
+static void keepVictim(Simulator *sim, unsigned long long address, int dirty){
+    BlockBuffer *victims = sim->victims;
+    int offsetBits = sim->levels[0]->offsetBits;
+    if(victims->count < victims->capacity){
+        bufferPush(victims, address >> offsetBits, dirty);
+        return;
+    }
+    unsigned long long dropped = victims->blocks[--victims->count];
+    int droppedDirty = victims->dirty[victims->count];
+    bufferPush(victims, address >> offsetBits, dirty);
+    if(droppedDirty){
+        writeBackBlock(sim, 0, dropped << offsetBits, NEVER_USED);
+    }
+}
+
+// take a block L1 missed on out of the victim cache, returns its dirty bit,
+// or -1 when the victim cache does not hold it. Only demand misses count as
+// hits, a prefetch taking the block back is no L1 miss.
+static int takeVictim(Simulator *sim, unsigned long long block, int prefetch){
+    int i = bufferFind(sim->victims, block);
+    if(i < 0){
+        return -1;
+    }
+    int dirty = sim->victims->dirty[i];
+    bufferRemove(sim->victims, i);
+    sim->stats.victimHits += !prefetch;
+    return dirty;
+}
+
+// an L1 miss on a block waiting in the write-back buffer gets a copy, the
+// write stays queued so a later write-back of the block coalesces with it,
+// prefetches are not counted as hits like in takeVictim
+static bool forwardBuffered(Simulator *sim, unsigned long long block, int prefetch){
+    if(bufferFind(sim->writeBackBuffer, block) < 0){
+        return false;
+    }
+    sim->stats.writeBackHits += !prefetch;
+    return true;
+}
+
+// an inclusive L2 victim leaves the buffers beside L1 too, dirty copies go
+// straight to memory like L1's own
+static void dropBuffered(Simulator *sim, unsigned long long address){
+    unsigned long long block = address >> sim->levels[0]->offsetBits;
+    int i;
+    if(sim->victims != NULL && (i = bufferFind(sim->victims, block)) >= 0){
+        sim->stats.memoryTraffic += sim->victims->dirty[i];
+        bufferRemove(sim->victims, i);
+    }
+    if(sim->writeBackBuffer != NULL && (i = bufferFind(sim->writeBackBuffer, block)) >= 0){
+        sim->stats.memoryTraffic += 1;
+        bufferRemove(sim->writeBackBuffer, i);
+    }
+}
+
+// remove a block from an upper level, dirty copies go straight to memory
+void backInvalidate(Simulator *sim, int currentLevel, unsigned long long address){
+    CacheLevel *cache = sim->levels[currentLevel];
+    if(currentLevel == 0 && (sim->victims != NULL || sim->writeBackBuffer != NULL)){
+        dropBuffered(sim, address);
+    }
+    Block upper;
+    decodeAddress(sim, currentLevel, 0, address, &upper);
+    int way = findWay(cache, &upper);
+    if(way < 0){
+        return;
+    }
+    int slot = upper.index * cache->associativity + way;
+    if(cache->dirty[slot] == 1){
+        sim->stats.memoryTraffic += 1;
+    }
+    if(cache->heap != NULL){
+        heapRemove(cache, upper.index, way);
+    }
+    if(cache->prefetched != NULL && cache->prefetched[slot]){
+        sim->stats.uselessPrefetches[currentLevel] += 1;
+        cache->prefetched[slot] = 0;
+    }
+    cache->tags[slot] = INVALID_TAG;
+    cache->dirty[slot] = 0;
+}
+
+// one read (0) or write (1) request to a level, misses allocate and are
+// filled by a read from the level below
+// prefetch fills take the miss path without touching the demand counters
+void accessLevel(Simulator *sim, int currentLevel, int operation, Block *block){
+    CacheLevel *cache = sim->levels[currentLevel];
+    SimStats *stats = &sim->stats;
+    int way = findWay(cache, block);
+    if(block->prefetch){
+        if(way < 0){
+            fillWay(sim, currentLevel, operation, block);
+        }
+        return;
+    }
+#ifdef MISS_CLASSES
+    int set = cache->slotSet != NULL ? cache->slotSet[block->index] : block->index;
+    profileAccess(sim->profiles[currentLevel], (block->tag << cache->indexBits) | set, block->index, way >= 0);
+#endif
+
+    // update read or write count
+    if(operation == 0){
+        stats->reads[currentLevel] += 1;
+    }
+    else{
+        stats->writes[currentLevel] += 1;
+    }
+
+    //if found in cache
+    if(way >= 0){
+        if(cache->policy->onHit != NULL){
+            cache->policy->onHit(cache, block->index, way);
+        }
+        if(cache->heap != NULL){
+            cache->nextUse[block->index * cache->associativity + way] = block->nextUse;
+            heapUpdate(cache, block->index, way);
+        }
+        if(operation == 1){
+            cache->dirty[block->index * cache->associativity + way] = 1;
+        }
+        // the first demand use of a prefetched block counts and trains the
+        // prefetcher like a miss would, L2 writes are L1 write-backs
+        int slot = block->index * cache->associativity + way;
+        if(cache->prefetched != NULL && cache->prefetched[slot] && (currentLevel == 0 || operation == 0)){
+            stats->usefulPrefetches[currentLevel] += 1;
+            cache->prefetched[slot] = 0;
+            runPrefetcher(sim, currentLevel, block);
+        }
+        return;
+    }
+
+    //update miss count
+    if(operation == 0){
+        stats->readMisses[currentLevel] += 1;
+    }
+    else{
+        stats->writeMisses[currentLevel] += 1;
+    }
+
+    fillWay(sim, currentLevel, operation, block);
+    if(sim->prefetchers[currentLevel] != NULL && (currentLevel == 0 || operation == 0)){
+        runPrefetcher(sim, currentLevel, block);
+    }
+}
+
+// allocate a way for a block that missed and fetch it from the level below,
+// or memory at the bottom, returns the way
+static int fillWay(Simulator *sim, int currentLevel, int operation, Block *block){
+    CacheLevel *cache = sim->levels[currentLevel];
+    SimStats *stats = &sim->stats;
+    // an L1 miss swaps with the victim cache before the eviction, so the
+    // victim takes the freed entry and nothing below is touched
+    unsigned long long number = (block->tag << cache->indexBits) | (unsigned long long)block->index;
+    int reclaimed = -1;
+    if(currentLevel == 0 && sim->victims != NULL){
+        reclaimed = takeVictim(sim, number, block->prefetch);
+    }
+    int way;
+    if(cache->heap != NULL){
+        way = selectOptimalVictim(sim, cache, block->index);
+    }else{
+        way = selectVictim(cache, block->index);
+    }
+    if(cache->tags[block->index * cache->associativity + way] != INVALID_TAG){
+        evictWay(sim, currentLevel, block->index, way);
+    }
+
+    // the write-back buffer is probed after the eviction, whose write-back
+    // may have drained or back-invalidated the entry
+    if(reclaimed < 0 && currentLevel == 0 && sim->writeBackBuffer != NULL && forwardBuffered(sim, number, block->prefetch)){
+        reclaimed = 0;
+    }
+    // fetch the block from the level below, or memory at the bottom
+    if(reclaimed < 0){
+        if(currentLevel + 1 < sim->totalLevels){
+            accessLevel(sim, currentLevel + 1, 0, block + 1);
+        }else{
+            stats->memoryTraffic += 1;
+            stats->prefetchTraffic += block->prefetch;
+        }
+    }
+
+    int slot = block->index * cache->associativity + way;
+    cache->tags[slot] = block->tag;
+    cache->dirty[slot] = operation == 1 || reclaimed == 1;
+    promoteWay(cache, block->index, way);
+    if(cache->policy->onFill != NULL){
+        cache->policy->onFill(cache, block->index, way);
+    }
+    if(cache->heap != NULL){
+        cache->nextUse[slot] = block->nextUse;
+        heapInsert(cache, block->index, way);
+    }
+    return way;
+}
+
+// train the level's prefetcher on a demand miss or first use of a prefetched
+// block and fill the blocks it proposes that the level does not hold yet,
+// the record of them is what the timing layer reads
+static void runPrefetcher(Simulator *sim, int currentLevel, Block *block){
+    Prefetcher *prefetcher = sim->prefetchers[currentLevel];
+    CacheLevel *cache = sim->levels[currentLevel];
+    unsigned long long candidates[MAX_PREFETCH_DEGREE];
+    int count = trainPrefetcher(prefetcher, (block->tag << cache->indexBits) | (unsigned long long)block->index, candidates);
+    prefetcher->issuedCount = 0;
+    prefetcher->issuedAt = sim->position;
+    for (int i = 0; i < count; i++){
+        Block blocks[MAX_LEVELS];
+        unsigned long long address = candidates[i] << cache->offsetBits;
+        for (int level = currentLevel; level < sim->totalLevels; level++){
+            decodeAddress(sim, level, 0, address, &blocks[level]);
+            blocks[level].nextUse = NEVER_USED;
+            blocks[level].prefetch = 1;
+        }
+        if(findWay(cache, &blocks[currentLevel]) >= 0){
+            continue;
+        }
+        long long traffic = sim->stats.prefetchTraffic;
+        int way = fillWay(sim, currentLevel, 0, &blocks[currentLevel]);
+        cache->prefetched[blocks[currentLevel].index * cache->associativity + way] = 1;
+        sim->stats.prefetches[currentLevel] += 1;
+        prefetcher->issued[prefetcher->issuedCount] = candidates[i];
+        prefetcher->issuedFromMemory[prefetcher->issuedCount++] = sim->stats.prefetchTraffic != traffic;
+    }
+}
+
+// split an address into the offset, index, and tag of one cache level, the
+// index is the slot the set is stored in
+void decodeAddress(Simulator *sim, int level, int operation, unsigned long long int address, Block *block){
+    CacheLevel *cache = sim->levels[level];
+    block->offset = address & cache->offsetMask;
+    block->index = (address >> cache->offsetBits) & cache->indexMask;
+    if(cache->setSlot != NULL){
+        block->index = cache->setSlot[block->index];
+    }
+    block->tag = address >> cache->tagShift;
+    block->validBit = 1;
+    block->dirtyBit = operation == 1;
+    block->prefetch = 0;
+}
+
+// decode an address for every level into blocks, one Block per level
+void decodeAccess(Simulator *sim, int operation, unsigned long long int address, Block *blocks){
+    for (int i = 0; i < sim->totalLevels; i++){
+        decodeAddress(sim, i, operation, address, &blocks[i]);
+    }
+}
+
+// A utility function to create a cache level
+CacheLevel *createCacheLevel(int level, int cacheSize, int associativity, int numSets, int blockSize, int replacementPolicy, int *setSlot) {
+    CacheLevel *cache = (CacheLevel *)malloc(sizeof(CacheLevel));
+    cache->level = level;
+    cache->cacheSize = cacheSize;
+    cache->associativity = associativity;
+    cache->numSets = numSets;
+    cache->offsetBits = log2Int(blockSize);
+    cache->indexBits = numSets > 0 ? log2Int(numSets) : 0;
+    cache->offsetMask = (1ULL << cache->offsetBits) - 1;
+    cache->indexMask = (1ULL << cache->indexBits) - 1;
+    cache->tagShift = cache->offsetBits + cache->indexBits;
+
+    // only the sampled sets get ways
+    cache->storedSets = numSets;
+    cache->setSlot = setSlot;
+    cache->slotSet = NULL;
+    if(setSlot != NULL){
+        cache->storedSets = 0;
+        for (int set = 0; set < numSets; set++){
+            cache->storedSets += setSlot[set] >= 0;
+        }
+        cache->slotSet = (int *)malloc(sizeof(int) * cache->storedSets);
+        for (int set = 0; set < numSets; set++){
+            if(setSlot[set] >= 0){
+                cache->slotSet[setSlot[set]] = set;
+            }
+        }
+    }
+
+    int numWays = cache->storedSets * associativity;
+    cache->tags = (unsigned long long *)malloc(sizeof(unsigned long long) * numWays);
+    cache->dirty = (unsigned char *)calloc(numWays, sizeof(unsigned char));
+    cache->rank = (unsigned short *)malloc(sizeof(unsigned short) * numWays);
+    for (int i = 0; i < numWays; i++){
+        cache->tags[i] = INVALID_TAG;
+        cache->rank[i] = i % associativity;
+    }
+
+    cache->plru = NULL;
+    cache->prefetched = NULL;
+    if(replacementPolicy == POLICY_PLRU){
+        cache->plru = (unsigned long long *)calloc(cache->storedSets, sizeof(unsigned long long));
+    }
+    cache->policy = findPolicy(replacementPolicy);
+    cache->wayState = NULL;
+    if(cache->policy->wayState){
+        cache->wayState = (unsigned char *)calloc(numWays, sizeof(unsigned char));
+    }
+    cache->psel = 1 << (PSEL_BITS - 1);
+    cache->fills = 0;
+    // any fixed non zero seed, different per level
+    cache->random = 0x9e3779b97f4a7c15ULL * level;
+
+    cache->nextUse = NULL;
+    cache->heap = NULL;
+    cache->heapIndex = NULL;
+    cache->heapCount = NULL;
+    if(replacementPolicy == POLICY_OPTIMAL){
+        cache->nextUse = (size_t *)malloc(sizeof(size_t) * numWays);
+        cache->heap = (unsigned short *)malloc(sizeof(unsigned short) * numWays);
+        cache->heapIndex = (unsigned short *)malloc(sizeof(unsigned short) * numWays);
+        cache->heapCount = (unsigned short *)calloc(cache->storedSets, sizeof(unsigned short));
+    }
+
+    return cache;
+}
+
+void freeCacheLevel(CacheLevel *cache) {
+    free(cache->tags);
+    free(cache->dirty);
+    free(cache->rank);
+    free(cache->plru);
+    free(cache->wayState);
+    free(cache->prefetched);
+    free(cache->nextUse);
+    free(cache->heap);
+    free(cache->heapIndex);
+    free(cache->heapCount);
+    free(cache->setSlot);
+    free(cache->slotSet);
+    free(cache);
+}
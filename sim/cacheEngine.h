@@ -0,0 +1,237 @@
+// two level write-back, write-allocate cache model
+// every piece of simulation state lives in a Simulator so several
+// configurations can run side by side in one process
+
+#ifndef CACHE_ENGINE_H
+#define CACHE_ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "prefetch.h"
+#ifdef MISS_CLASSES
+#include "missProfile.h"
+#endif
+
+#define MAX_LEVELS 2
+
+// values of SimConfig.replacementPolicy
+#define POLICY_LRU 1
+#define POLICY_FIFO 2
+#define POLICY_OPTIMAL 3
+// tree pseudo-LRU, assoc - 1 bits per set pick the victim
+#define POLICY_PLRU 4
+// a pseudo random way
+#define POLICY_RANDOM 5
+// static, bimodal, and set dueling dynamic re-reference interval prediction
+#define POLICY_SRRIP 6
+#define POLICY_BRRIP 7
+#define POLICY_DRRIP 8
+// least frequently used, counts age by halving
+#define POLICY_LFU 9
+
+// next use position of a block that is never accessed again
+#define NEVER_USED ((size_t)-1)
+
+// tag value held by a way that does not contain a block, real tags are
+// address >> (offset bits + index bits) so they never reach it
+#define INVALID_TAG (~0ULL)
+
+typedef struct Block
+{
+    int validBit;
+    int dirtyBit;
+    unsigned long long tag;
+    int offset;
+    int index;
+    // trace position of the next access to this block, OPTIMAL only
+    size_t nextUse;
+    // a prefetch fill, counted apart from the demand accesses
+    int prefetch;
+} Block;
+
+struct ReplacementPolicy;
+
+typedef struct CacheLevel
+{
+    int level;
+    int cacheSize;
+    int associativity;
+    int numSets;
+    int offsetBits;
+    int indexBits;
+    // address decoding constants, fixed when the level is created
+    unsigned long long offsetMask;
+    unsigned long long indexMask;
+    int tagShift;
+    // set-major way arrays, way w of set s lives at [s * associativity + w]
+    unsigned long long *tags;
+    unsigned char *dirty;
+    // recency rank of each way in its set, 0 is the most recently used (LRU)
+    // or filled (FIFO) way and associativity - 1 is the next victim
+    unsigned short *rank;
+    // PLRU only, per set the tree bits, node n is bit n - 1 with the root at
+    // node 1, the children of n at 2n and 2n + 1, and way w at leaf
+    // associativity + w. A clear bit sends the victim search left.
+    unsigned long long *plru;
+    // the policy's hooks, and per way the state of the policies that keep
+    // their own, see policy.h
+    const struct ReplacementPolicy *policy;
+    unsigned char *wayState;
+    // DRRIP set dueling selector, BRRIP fills so far, and RANDOM's generator
+    int psel;
+    unsigned int fills;
+    unsigned long long random;
+    // with a prefetcher only, per way whether a prefetch filled the block
+    // and no demand access has used it yet
+    unsigned char *prefetched;
+    // OPTIMAL only, per way the trace position of its block's next access
+    // and per set a max-heap of the occupied ways keyed by it
+    size_t *nextUse;
+    unsigned short *heap;
+    unsigned short *heapIndex;
+    unsigned short *heapCount;
+    // set sampling only, the slot in the way arrays of every set or -1 when
+    // the set is not simulated, and the set held in each of the storedSets
+    // slots, without sampling every set is stored in its own slot
+    int storedSets;
+    int *setSlot;
+    int *slotSet;
+} CacheLevel;
+
+// most entries the victim cache and the write-back buffer may have
+#define MAX_BUFFER_ENTRIES 32
+
+// a small fully associative store of blocks beside L1, used for the victim
+// cache and the write-back buffer, blocks are address >> offset bits and
+// entry 0 is the most recently inserted
+typedef struct BlockBuffer
+{
+    int capacity;
+    int count;
+    unsigned long long blocks[MAX_BUFFER_ENTRIES];
+    unsigned char dirty[MAX_BUFFER_ENTRIES];
+} BlockBuffer;
+
+typedef struct SimConfig
+{
+    int blockSize;
+    int cacheSize[MAX_LEVELS];
+    int associativity[MAX_LEVELS];
+    int replacementPolicy;
+    // 0 for non-inclusive, 1 for inclusive
+    int inclusionProperty;
+    // simulate 1 in setSampling of the sets, 0 or 1 simulates them all
+    int setSampling;
+    // PREFETCH_NONE or the prefetcher of each level, with how many blocks
+    // it fetches per trigger and how far ahead of the trigger they start
+    int prefetcher[MAX_LEVELS];
+    int prefetchDegree[MAX_LEVELS];
+    int prefetchDistance[MAX_LEVELS];
+    // entries of the victim cache L1 evicts into and of the buffer dirty
+    // blocks leaving L1 coalesce in, 0 leaves either out
+    int victimEntries;
+    int writeBackEntries;
+} SimConfig;
+
+typedef struct SimStats
+{
+    long long reads[MAX_LEVELS];
+    long long readMisses[MAX_LEVELS];
+    long long writes[MAX_LEVELS];
+    long long writeMisses[MAX_LEVELS];
+    long long writeBacks[MAX_LEVELS];
+    long long writeThroughs[MAX_LEVELS];
+    double missRate[MAX_LEVELS];
+    long long cacheToCacheTransfers[MAX_LEVELS];
+    //evictions
+    long long memoryTraffic;
+    // blocks each level's prefetcher filled, and of those the ones a demand
+    // access used and the ones evicted unused
+    long long prefetches[MAX_LEVELS];
+    long long usefulPrefetches[MAX_LEVELS];
+    long long uselessPrefetches[MAX_LEVELS];
+    // part of memoryTraffic that prefetches fetched
+    long long prefetchTraffic;
+    // L1 misses the victim cache or write-back buffer served, write-backs
+    // that merged with a queued write of their block, and buffered blocks
+    // written to the level below
+    long long victimHits;
+    long long writeBackHits;
+    long long writeBackCoalesced;
+    long long writeBackDrains;
+    // entries in use summed over every access, for the mean occupancy
+    long long victimOccupancy;
+    long long writeBackOccupancy;
+} SimStats;
+
+typedef struct Simulator
+{
+    SimConfig config;
+    int totalLevels;
+    // hold number of cache sets for L1 and L2 just at index 0 and 1
+    int numSets[MAX_LEVELS];
+    CacheLevel *levels[MAX_LEVELS];
+    SimStats stats;
+    // OPTIMAL only, buildNextUse output for the trace being replayed and
+    // the position of the access in flight
+    const size_t *nextUse;
+    size_t position;
+#ifdef MISS_CLASSES
+    // 3C and per-set counters of each level
+    MissProfile *profiles[MAX_LEVELS];
+#endif
+    // set sampling only, accesses are grouped by the index bits every level
+    // shares, groupOf maps those bits to the group's counters in groups, or
+    // to -1 when the group is not sampled and its accesses are dropped
+    int sharedMask;
+    int *groupOf;
+    int numGroups;
+    int sampledGroups;
+    struct Sample *groups;
+    // per level its prefetcher, or NULL
+    Prefetcher *prefetchers[MAX_LEVELS];
+    // between L1 and the level below, NULL when not configured
+    BlockBuffer *victims;
+    BlockBuffer *writeBackBuffer;
+} Simulator;
+
+// returned by createSimulator when a level's set count is not a power of 2
+#define SIM_BAD_L1_SETS 1
+#define SIM_BAD_L2_SETS 2
+// and when setSampling is not a power of 2 or exceeds the sets the levels share
+#define SIM_BAD_SET_SAMPLING 3
+// and when PLRU is asked of a level whose ways are not a power of 2 up to 64
+#define SIM_BAD_PLRU_WAYS 4
+// and when a prefetcher's degree or distance is out of range or it is asked
+// for under OPTIMAL or set sampling
+#define SIM_BAD_PREFETCH 5
+// and when the victim cache or write-back buffer is larger than
+// MAX_BUFFER_ENTRIES or asked for under set sampling
+#define SIM_BAD_BUFFERS 6
+
+int createSimulator(Simulator *sim, const SimConfig *config);
+void freeSimulator(Simulator *sim);
+
+// for every access the position of the next access to the same block, or
+// NEVER_USED, which OPTIMAL needs before the first simulateAccess
+size_t *buildNextUse(const unsigned long long *addresses, size_t length, int blockSize);
+
+// run one access, operation is 0 for read and 1 for write
+void simulateAccess(Simulator *sim, int operation, unsigned long long address);
+// fill in the miss rates once the trace is done
+void finishSimulation(Simulator *sim);
+
+bool isPowerOfTwo(int x);
+int log2Int(int x);
+int findWay(CacheLevel *cache, Block *block);
+int selectVictim(CacheLevel *cache, int set);
+void promoteWay(CacheLevel *cache, int set, int way);
+int plruVictim(CacheLevel *cache, int set);
+void plruTouch(CacheLevel *cache, int set, int way);
+unsigned long long wayAddress(CacheLevel *cache, int slot, int way);
+void decodeAddress(Simulator *sim, int level, int operation, unsigned long long int address, Block *block);
+// setSlot is NULL to store every set, otherwise the level takes it over
+CacheLevel *createCacheLevel(int level, int cacheSize, int associativity, int numSets, int blockSize, int replacementPolicy, int *setSlot);
+void freeCacheLevel(CacheLevel *cache);
+
+#endif
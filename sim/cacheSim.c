@@ -3,225 +3,607 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ourHeaders.h"
-#include <math.h>
-
-typedef struct Block
-{
-    int validBit;
-    int dirtyBit;
-    int tag;
-    int offset;
-    int index;
-} Block;
-
-typedef struct Node{
-    struct Block data;
-    struct Node *next;
-    struct Node *previous;
-}Node;
-
-typedef struct Set
-{
-    struct Node *head;
-    struct Node *tail;
-    int size;
-    int capacity;
-    int lru;
-} Set;
-
-typedef struct CacheLevel
+#include "cacheSim.h"
+#include "policy.h"
+#include "traceReader.h"
+#include "traceRing.h"
+#include "sweep.h"
+#include "multicore.h"
+#include "stackDistance.h"
+#include "shard.h"
+#include "kernels.h"
+#include "interval.h"
+#include "checkpoint.h"
+#include "sampling.h"
+#include "estimate.h"
+#include "timing.h"
+#ifdef LEAK_DETECT
+#include "leak_detector_c.h"
+#endif
+
+#ifdef MISS_CLASSES
+// thrashed sets listed per level by printMissProfile
+#ifndef MISS_TOP_SETS
+#define MISS_TOP_SETS 8
+#endif
+#endif
+
+// what a single run has to stop for on the way through the trace
+typedef struct RunStops
 {
-    int level;
-    int cacheSize;
-    int associativity;
-    int numSets;
-    Set *sets;
-} CacheLevel;
-
-
-bool isPowerOfTwo(int x);
-
-int checkBlock(char *input);
-int checkCacheSize(char *input, int chacheLevel);
-int checkCacheAssoc(char *input, int assoc);
-int checkReplacementPolicy(char *input);
-int checkInclusionProperty(char *input);
-int checkTraceFile(char *input);
-void evictBlock(int currentLevel, Block *blockAddress);
-void LRUPolicy(Node *temp, int currentLevel, int currentSet);
-void inclusion(int currentLevel, int operation, Block *blockAddress);
-Block *createMemoryAddress(int operation, unsigned long long int address, int* NUM_CACHE_SETS);
-CacheLevel *createCacheLevel(int level, int cacheSize, int associativity, int numSets);
-
-void printSet(int setIndex, int cacheLevel);
-void checkTag(int operation, Block *blockAddress);
-void printInfo();
-void printCache();
-
-// global variables
-int BLOCK_SIZE = -1;
-
-int L1_CACHE_SIZE = -1;
-int L1_ASSOCIATIVITY = -1;
-int L2_CACHE_SIZE = -1;
-int L2_ASSOCIATIVITY = -1;
-
-int REPLACEMENT_POLICY = -1;
-int INCLUSION_PROPERTY = -1;
-
-int TOTAL_LEVELS = 0;
-
-char *TRACE_FILE_NAME = NULL;
-FILE *INPUT_FILE = NULL;
-
-CacheLevel **MAIN_CACHE = NULL;
-// hold number of cache sets for L1 and L2 just at index 0 and 1
-int NUM_CACHE_SETS[2];
-
-int reads[2];
-int readMisses[2];
-int writes[2];
-int writeMisses[2];
-int writeBacks[2];
-int writeThroughs[2];
-double missRate[2];
-int cacheToCacheTransfers[2];
-//evictions
-int memoryTraffic;
+    IntervalReport report;
+    int intervals;
+    // --checkpoint position and file, the path is NULL once it is written
+    size_t checkpointAt;
+    const char *checkpointPath;
+    // --timing model, NULL when only the events are counted
+    TimingModel *timing;
+} RunStops;
+
+int checkTraceFile(char *input, TraceReader *reader);
+static size_t untilStop(const RunStops *stops, const Simulator *sim, size_t most);
+static int atStop(RunStops *stops, Simulator *sim);
+static void runBatch(RunStops *stops, Simulator *sim, const unsigned char *operations, const unsigned long long *addresses, size_t count);
+
+int VERBOSE = 0;
 
 int main(int argc, char *argv[])
 {
+    // hold the sweep and parallel thread count, 0 picks one per core
+    int sweep = 0;
+    int multicore = 0;
+    int threads = 0;
+    int stackDistance = 0;
+    int parallel = 0;
+    // window length of --interval, 0 when only the final report is printed
+    long long interval = 0;
+    const char *intervalFormat = "csv";
+    long long checkpointAt = 0;
+    const char *checkpointPath = NULL;
+    const char *restorePath = NULL;
+    int sampled = 0;
+    SampleConfig sample;
+    // --set-sample rate, 0 simulates every set
+    int setSampling = 0;
+    int timed = 0;
+    TimingConfig timingConfig;
+    const char *mshrs = NULL;
+    int writeBuffer = 0;
+    // --prefetch options, parsed once the config exists
+    char *prefetch[MAX_LEVELS];
+    int prefetches = 0;
+    int victimEntries = 0;
+    int writeBackEntries = 0;
+
+    // pull the options out so the positional arguments keep their place
+    int positional = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--verbose") == 0)
+        {
+            VERBOSE = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--sweep") == 0)
+        {
+            sweep = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--multicore") == 0)
+        {
+            multicore = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--parallel") == 0)
+        {
+            parallel = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--stack-distance") == 0)
+        {
+            stackDistance = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+        {
+            interval = atoll(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--interval-format") == 0 && i + 1 < argc)
+        {
+            intervalFormat = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--checkpoint") == 0 && i + 2 < argc)
+        {
+            checkpointAt = atoll(argv[++i]);
+            checkpointPath = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--set-sample") == 0 && i + 1 < argc)
+        {
+            setSampling = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc)
+        {
+            restorePath = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc)
+        {
+            if (parseSampleConfig(argv[++i], &sample) != 0)
+            {
+                printf(">>> --sample takes PERIOD,DETAIL,WARMUP with 0 < DETAIL <= PERIOD and WARMUP a count or all\n");
+                return 1;
+            }
+            sampled = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--timing") == 0 && i + 1 < argc)
+        {
+            if (parseTimingLatencies(argv[++i], &timingConfig) != 0)
+            {
+                printf(">>> --timing takes L1,L2,MEMORY latencies of at least 1 cycle\n");
+                return 1;
+            }
+            timed = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc)
+        {
+            if (prefetches == MAX_LEVELS)
+            {
+                printf(">>> --prefetch can be given once per level\n");
+                return 1;
+            }
+            prefetch[prefetches++] = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--victim-cache") == 0 && i + 1 < argc)
+        {
+            victimEntries = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--writeback-buffer") == 0 && i + 1 < argc)
+        {
+            writeBackEntries = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--mshrs") == 0 && i + 1 < argc)
+        {
+            mshrs = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--write-buffer") == 0 && i + 1 < argc)
+        {
+            writeBuffer = atoi(argv[++i]);
+            continue;
+        }
+        argv[positional++] = argv[i];
+    }
+    argc = positional;
+    if (!timed && (mshrs != NULL || writeBuffer != 0))
+    {
+        printf(">>> --mshrs and --write-buffer need --timing\n");
+        return 1;
+    }
+    if (timed && ((mshrs != NULL && parseTimingMshrs((char *)mshrs, &timingConfig) != 0) || writeBuffer < 0))
+    {
+        printf(">>> --mshrs takes N or L1,L2 of at least 1 and --write-buffer a positive entry count\n");
+        return 1;
+    }
+    if (timed && writeBuffer > 0)
+    {
+        timingConfig.writeBuffer = writeBuffer;
+    }
+
+    if (stackDistance && argc == 3)
+    {
+        return runStackDistance(argv[1], argv[2]);
+    }
+
     // if number of command line args is not 8 then exit
     if (argc != 9)
     {
-        printf("Usage: ./cacheSim <BLOCKSIZE> <L1_SIZE> <L1_ASSOC> <L2_SIZE> <L2_ASSOC> <REPLACEMENT_POLICY> <INCLUSION_PROPERTY> <trace_file>\n");
+        printf("Usage: ./cacheSim [--verbose] [--parallel [--threads N]] [--interval N [--interval-format csv|json]] <BLOCKSIZE> <L1_SIZE> <L1_ASSOC> <L2_SIZE> <L2_ASSOC> <REPLACEMENT_POLICY> <INCLUSION_PROPERTY> <trace_file>\n");
+        printf("       ./cacheSim --sweep [--threads N] [--set-sample K] <BLOCKSIZES> <L1_SIZES> <L1_ASSOCS> <L2_SIZES> <L2_ASSOCS> <REPLACEMENT_POLICIES> <INCLUSION_PROPERTIES> <trace_file>\n");
+        printf("       REPLACEMENT_POLICY is LRU, FIFO, OPTIMAL, PLRU, RANDOM, SRRIP, BRRIP, DRRIP, or LFU\n");
+        printf("       sweep arguments are comma separated lists, every combination is simulated\n");
+        printf("       ./cacheSim --multicore [--threads N] <BLOCKSIZE> <L1_SIZE> <L1_ASSOC> <L2_SIZE> <L2_ASSOC> <REPLACEMENT_POLICY> <INCLUSION_PROPERTY> <trace,trace,...>\n");
+        printf("       one core with a private MESI L1 per trace over a shared L2, each core gets a thread\n");
+        printf("       when --threads, by default one per CPU, covers them all\n");
+        printf("       ./cacheSim --stack-distance <BLOCKSIZE> <trace_file>\n");
+        printf("       a trace_file of - reads stdin, pipes, FIFOs, and gzip files are streamed, --interval prints the\n");
+        printf("       counters of every N accesses as they are simulated\n");
+        printf("       single runs also take --checkpoint <ACCESSES> <file> and --restore <file>, and\n");
+        printf("       --sample <PERIOD,DETAIL,WARMUP> to measure DETAIL of every PERIOD accesses, and\n");
+        printf("       --set-sample <K> to simulate 1 in K sets, K a power of 2, and --timing <L1,L2,MEMORY>\n");
+        printf("       hit and memory latencies in cycles for AMAT and stalls, with --mshrs <N|L1,L2> per\n");
+        printf("       level and --write-buffer <N> entries, 8 of each by default, and --prefetch\n");
+        printf("       <LEVEL,next|stride|stream[,DEGREE[,DISTANCE]]> once per level, 1 and 1 by default,\n");
+        printf("       --victim-cache <N> and --writeback-buffer <N> put up to %i entries beside L1\n", MAX_BUFFER_ENTRIES);
         return 1;
     }
 
     // ./cacheSim 16 1024 1 8192 4 LRU inclusive ./traces/compress_trace.txt
 
-    if (checkBlock(argv[1]) != 0 || 
-        checkCacheSize(argv[2], 1) != 0 || 
-        checkCacheAssoc(argv[3], 1) != 0 || 
-        checkCacheSize(argv[4], 2) != 0 || 
-        checkCacheAssoc(argv[5], 2) != 0 || 
-        checkReplacementPolicy(argv[6]) != 0 || 
-        checkInclusionProperty(argv[7]) != 0 || 
-        checkTraceFile(argv[8]) != 0) 
+    if (sweep && (multicore || parallel || interval != 0 || checkpointPath != NULL || restorePath != NULL || sampled ||
+                  timed || prefetches > 0 || victimEntries != 0 || writeBackEntries != 0))
+    {
+        printf(">>> --sweep only takes --threads and --set-sample\n");
+        return 1;
+    }
+    if (sweep)
+    {
+        return runSweep(argv + 1, argv[8], threads, setSampling);
+    }
+    if (multicore && (parallel || interval != 0 || checkpointPath != NULL || restorePath != NULL || sampled ||
+                      setSampling > 1 || timed || prefetches > 0 || victimEntries != 0 || writeBackEntries != 0))
+    {
+        printf(">>> --multicore only takes --threads\n");
+        return 1;
+    }
+    if (multicore)
+    {
+        return runMulticore(argv + 1, argv[8], threads);
+    }
+
+    SimConfig config;
+    TraceReader reader;
+    memset(config.prefetcher, 0, sizeof(config.prefetcher));
+    config.victimEntries = victimEntries;
+    config.writeBackEntries = writeBackEntries;
+    for (int i = 0; i < prefetches; i++)
+    {
+        if (checkPrefetch(prefetch[i], &config) != 0)
+        {
+            return 1;
+        }
+    }
+    if (checkBlock(argv[1], &config) != 0 || 
+        checkCacheSize(argv[2], 1, &config) != 0 || 
+        checkCacheAssoc(argv[3], 1, &config) != 0 || 
+        checkCacheSize(argv[4], 2, &config) != 0 || 
+        checkCacheAssoc(argv[5], 2, &config) != 0 || 
+        checkReplacementPolicy(argv[6], &config) != 0 || 
+        checkInclusionProperty(argv[7], &config) != 0 || 
+        checkTraceFile(argv[8], &reader) != 0) 
+    {
+        return 1;
+    }
+    if (interval < 0 || (interval > 0 && parallel))
+    {
+        printf(">>> --interval must be a positive access count and cannot be combined with --parallel\n");
+        closeTrace(&reader);
+        return 1;
+    }
+    if (checkpointAt < 0 || (parallel && (checkpointPath != NULL || restorePath != NULL)))
+    {
+        printf(">>> --checkpoint needs a non negative access count, checkpoints cannot be combined with --parallel\n");
+        closeTrace(&reader);
+        return 1;
+    }
+    if (setSampling > 1 && (sampled || interval > 0 || checkpointPath != NULL || restorePath != NULL))
+    {
+        printf(">>> --set-sample cannot be combined with --sample, --interval, or checkpoints\n");
+        closeTrace(&reader);
+        return 1;
+    }
+    if (sampled && (parallel || interval > 0 || checkpointPath != NULL || config.replacementPolicy == POLICY_OPTIMAL))
+    {
+        printf(">>> --sample cannot be combined with --parallel, --interval, --checkpoint, or OPTIMAL\n");
+        closeTrace(&reader);
+        return 1;
+    }
+    if (prefetches > 0 && (parallel || setSampling > 1 || checkpointPath != NULL || restorePath != NULL))
     {
+        printf(">>> --prefetch cannot be combined with --parallel, --set-sample, or checkpoints\n");
+        closeTrace(&reader);
         return 1;
     }
-    printf("%s\n", argv[6]);
-    printf("%s\n", argv[7]);
-    // hold read or write operation
-    char operation;
+    if ((victimEntries != 0 || writeBackEntries != 0) && (parallel || checkpointPath != NULL || restorePath != NULL))
+    {
+        printf(">>> --victim-cache and --writeback-buffer cannot be combined with --parallel or checkpoints\n");
+        closeTrace(&reader);
+        return 1;
+    }
+    if (timed && (parallel || sampled || setSampling > 1))
+    {
+        printf(">>> --timing cannot be combined with --parallel, --sample, or --set-sample\n");
+        closeTrace(&reader);
+        return 1;
+    }
+    if (VERBOSE)
+    {
+        printf("%s\n", argv[6]);
+        printf("%s\n", argv[7]);
+    }
     // hold operation as int, 0 for read, 1 for write
     int opIntRep = 0;
     unsigned long long int address = 0;
 
-    // avoid divide by zero error if associativity is 0
-    NUM_CACHE_SETS[0] = L1_ASSOCIATIVITY <= 0 ? 0 : L1_CACHE_SIZE / (L1_ASSOCIATIVITY * BLOCK_SIZE);
-
-    if (!isPowerOfTwo(NUM_CACHE_SETS[0]))
+    Simulator sim;
+    config.setSampling = setSampling;
+    int status = createSimulator(&sim, &config);
+    if (status == SIM_BAD_L1_SETS)
     {
         printf("L1 sets is not a power of 2, please re check values\n");
+        closeTrace(&reader);
         return 1;
     }
-
-    // avoid divide by zero error if associativity is 0
-    NUM_CACHE_SETS[1] = L2_ASSOCIATIVITY <= 0 ? 0 : L2_CACHE_SIZE / (L2_ASSOCIATIVITY * BLOCK_SIZE);
-
-    if(NUM_CACHE_SETS[1] > 0 && NUM_CACHE_SETS[0] > 0){
-        TOTAL_LEVELS = 2;
-    }else{
-        TOTAL_LEVELS = 1;
-    }
-
-    if (!isPowerOfTwo(NUM_CACHE_SETS[1]))
+    if (status == SIM_BAD_L2_SETS)
     {
         printf("L2 sets is not a power of 2, please re check values\n");
+        closeTrace(&reader);
+        return 1;
+    }
+    if (status == SIM_BAD_SET_SAMPLING)
+    {
+        printf(">>> --set-sample must be a power of 2 no larger than the smaller level's set count\n");
+        closeTrace(&reader);
+        return 1;
+    }
+    if (status == SIM_BAD_PLRU_WAYS)
+    {
+        printf(">>> PLRU needs a power of 2 associativity of at most 64 at every level\n");
+        closeTrace(&reader);
+        return 1;
+    }
+    if (status == SIM_BAD_BUFFERS)
+    {
+        printf(">>> --victim-cache and --writeback-buffer take 1 to %i entries and cannot be combined with OPTIMAL or --set-sample\n",
+               MAX_BUFFER_ENTRIES);
+        closeTrace(&reader);
+        return 1;
+    }
+    if (status == SIM_BAD_PREFETCH)
+    {
+        printf(">>> --prefetch takes a degree of 1 to %i and a distance of at least 1 and cannot be combined with OPTIMAL or --set-sample\n",
+               MAX_PREFETCH_DEGREE);
+        closeTrace(&reader);
         return 1;
     }
 
-    // create MAIN_CACHE
-    int num_of_cache_levels = 2;
-    MAIN_CACHE = malloc(num_of_cache_levels * sizeof(CacheLevel *));
-
-    MAIN_CACHE[0] = createCacheLevel(1, L1_CACHE_SIZE, L1_ASSOCIATIVITY, NUM_CACHE_SETS[0]);
-    MAIN_CACHE[1] = createCacheLevel(2, L2_CACHE_SIZE, L2_ASSOCIATIVITY, NUM_CACHE_SETS[1]);
-
-    printInfo();
-    // read file for debugging
-    while (!feof(INPUT_FILE)) {
-        int read = fscanf(INPUT_FILE, " %c %llx", &operation, &address);
-        printf("read: %i %llx\n", operation, address);
-        if(read == EOF){
-            break;
+    printInfo(&sim, argv[8]);
+    if (restorePath != NULL)
+    {
+        status = loadCheckpoint(&sim, restorePath);
+        if (status != 0)
+        {
+            printf(status == CHECKPOINT_MISMATCH ? ">>> Checkpoint %s was saved with another configuration\n"
+                                                 : "Could not read checkpoint %s.\n", restorePath);
+            closeTrace(&reader);
+            freeSimulator(&sim);
+            return 1;
         }
-        printf("still read: %i %llx\n", operation, address);
-
-        if(operation =='r'){
-            opIntRep = 0;
+    }
+    RunStops stops;
+    stops.intervals = interval > 0;
+    stops.checkpointAt = checkpointAt;
+    stops.checkpointPath = checkpointPath;
+    stops.timing = NULL;
+    if (stops.intervals && startIntervals(&stops.report, &sim, stdout, interval, intervalFormat) != 0)
+    {
+        printf(">>> Interval format must be csv or json\n");
+        closeTrace(&reader);
+        freeSimulator(&sim);
+        return 1;
+    }
+    if (atStop(&stops, &sim) != 0)
+    {
+        closeTrace(&reader);
+        freeSimulator(&sim);
+        return 1;
+    }
+    // a restored run starts timing with idle MSHRs and an empty write buffer
+    TimingModel timing;
+    if (timed)
+    {
+        startTiming(&timing, &sim, &timingConfig);
+        stops.timing = &timing;
+    }
+#ifdef LEAK_DETECT
+    unsigned long long allocationsBefore = ALLOCATION_COUNT;
+#endif
+    if (config.replacementPolicy == POLICY_OPTIMAL || parallel)
+    {
+        // OPTIMAL looks ahead and shards are split out of the whole trace,
+        // so it is decoded up front
+        TraceBuffer trace;
+        if (loadOpenTrace(&reader, &trace) != 0)
+        {
+            printf("Could not open file.\n");
+            if (timed)
+            {
+                freeTiming(&timing);
+            }
+            freeSimulator(&sim);
+            return 1;
         }
-        else if(operation =='w'){
-            opIntRep = 1;
+        size_t *nextUse = NULL;
+        if (config.replacementPolicy == POLICY_OPTIMAL)
+        {
+            nextUse = buildNextUse(trace.addresses, trace.length, config.blockSize);
         }
-        Block *blockAddress = createMemoryAddress(opIntRep, address, NUM_CACHE_SETS);
-        checkTag(opIntRep, blockAddress);
-        // free blockAddress after use, relevent data has been copied to cache
-        free(blockAddress);
-
+        if (parallel)
+        {
+            int shards = runSharded(&sim, &trace, nextUse, threads);
+            if (VERBOSE)
+            {
+                printf("shards: %i\n", shards);
+            }
+        }
+        else
+        {
+            sim.nextUse = nextUse;
+            if (VERBOSE)
+            {
+                for (size_t i = sim.position; i < trace.length; i++)
+                {
+                    printf("read: %i %llx\n", trace.operations[i], trace.addresses[i]);
+                }
+            }
+            // a restored run picks the trace up where the checkpoint left it
+            while (sim.position < trace.length)
+            {
+                size_t n = untilStop(&stops, &sim, trace.length - sim.position);
+                runBatch(&stops, &sim, trace.operations + sim.position, trace.addresses + sim.position, n);
+                if (atStop(&stops, &sim) != 0)
+                {
+                    break;
+                }
+            }
+        }
+        free(nextUse);
+        freeTraceBuffer(&trace);
     }
-    // calculate miss rates
-    if(readMisses[0] == 0 || writeMisses[0] == 0){
-        missRate[0] = 0;
-    }else{
-        missRate[0] = (double)(readMisses[0] + writeMisses[0]) / (reads[0] + writes[0]);
+    else
+    {
+        // a restored run skips what the checkpoint already covers
+        for (size_t i = 0; i < sim.position && nextAccess(&reader, &opIntRep, &address); i++)
+        {
+        }
+        if (sampled)
+        {
+            status = runSampled(&sim, &reader, &sample);
+            closeTrace(&reader);
+            freeSimulator(&sim);
+            if (status != 0)
+            {
+                printf(">>> The trace is shorter than one sample period\n");
+                return 1;
+            }
+            return 0;
+        }
 
+        // the reader thread decodes the trace into the ring while the
+        // simulation runs the batches before it, memory stays bounded by the
+        // ring so pipes of any length stream through, and a batch is cut
+        // short where an interval or the checkpoint is due
+        TraceRing ring;
+        if (startTraceRing(&ring, &reader) != 0)
+        {
+            printf(">>> Could not start the trace reader\n");
+            closeTrace(&reader);
+            if (timed)
+            {
+                freeTiming(&timing);
+            }
+            freeSimulator(&sim);
+            return 1;
+        }
+        const TraceBatch *batch;
+        int stopped = 0;
+        while (!stopped && (batch = nextTraceBatch(&ring)) != NULL)
+        {
+            if (VERBOSE)
+            {
+                for (size_t i = 0; i < batch->count; i++)
+                {
+                    printf("read: %i %llx\n", batch->operations[i], batch->addresses[i]);
+                }
+            }
+            for (size_t done = 0; done < batch->count && !stopped;)
+            {
+                size_t n = untilStop(&stops, &sim, batch->count - done);
+                runBatch(&stops, &sim, batch->operations + done, batch->addresses + done, n);
+                done += n;
+                stopped = atStop(&stops, &sim) != 0;
+            }
+        }
+        stopTraceRing(&ring);
+#ifdef LEAK_DETECT
+        printf("heap allocations during simulation: %llu\n", ALLOCATION_COUNT - allocationsBefore);
+#endif
+        closeTrace(&reader);
+    }
+    if (stops.intervals)
+    {
+        reportInterval(&stops.report, &sim, 1);
+    }
+    if (stops.checkpointPath != NULL)
+    {
+        printf(">>> The trace ended before access %zu, no checkpoint was written\n", stops.checkpointAt);
     }
-    if(readMisses[1] == 0 || writeMisses[1] == 0){
-        missRate[1] = 0;
-    }else{
-        missRate[1] = (double)(readMisses[1] + writeMisses[1]) / (reads[1] + writes[1]);
+    finishSimulation(&sim);
+    if (sim.groupOf != NULL)
+    {
+        printSetSampleEstimate(&sim);
+    }
+    else
+    {
+        printCache(&sim);
+    }
+#ifdef MISS_CLASSES
+    printMissProfile(&sim);
+#endif
+    printPrefetch(&sim);
+    printBuffers(&sim);
+    if (timed)
+    {
+        printTiming(&timing);
+        freeTiming(&timing);
     }
-    printCache();
     
     // free all malloced memory
-    for (int i = 0; i < 2; i++){
-        //printf("fgdfgsfgsdfg %i\n", NUM_CACHE_SETS[i]);
-        for (int j = 0; j < NUM_CACHE_SETS[i]; j++){
-            //printf("freeing nodes now\n");
-            Node *current = MAIN_CACHE[i]->sets[j].head;
-            // as long as the set at the index was instantiated
-            while (current != NULL){
-                Node *freeNode = current;
-                current = current->next;
-                free(freeNode);
-            }
-            free(current);
-        }
-        free(MAIN_CACHE[i]->sets);        
-        free(MAIN_CACHE[i]);
-    }
-    free(MAIN_CACHE);
-    fclose(INPUT_FILE);
+    freeSimulator(&sim);
     return 0;
 }
 
-// function to check if a number is a power of 2
-bool isPowerOfTwo(int x) {
-    // 8 is 1000
-    // 7 is 0111,
-    // so 8 & 7 = 0
+static size_t untilStop(const RunStops *stops, const Simulator *sim, size_t most) {
+    if (stops->intervals && intervalRoom(&stops->report, sim) < most)
+    {
+        most = intervalRoom(&stops->report, sim);
+    }
+    if (stops->checkpointPath != NULL && stops->checkpointAt > sim->position && stops->checkpointAt - sim->position < most)
+    {
+        most = stops->checkpointAt - sim->position;
+    }
+    return most;
+}
 
-    // 7 is 0111
-    // 6 is 0110
-    // so 7 & 6 = 6 or essentiall not 0
+// simulate a batch, through the timing model when there is one
+static void runBatch(RunStops *stops, Simulator *sim, const unsigned char *operations, const unsigned long long *addresses, size_t count) {
+    if (stops->timing != NULL)
+    {
+        timeBatch(stops->timing, sim, operations, addresses, count);
+    }
+    else
+    {
+        simulateBatch(sim, operations, addresses, count);
+    }
+}
 
-    return !(x & (x - 1));
+// report the window and save the checkpoint when sim just reached them,
+// returns -1 if the checkpoint could not be written
+static int atStop(RunStops *stops, Simulator *sim) {
+    if (stops->intervals)
+    {
+        reportInterval(&stops->report, sim, 0);
+    }
+    if (stops->checkpointPath != NULL && sim->position == stops->checkpointAt)
+    {
+        if (saveCheckpoint(sim, stops->checkpointPath) != 0)
+        {
+            printf("Could not write checkpoint %s.\n", stops->checkpointPath);
+            return -1;
+        }
+        if (VERBOSE)
+        {
+            printf("checkpoint: %zu\n", sim->position);
+        }
+        stops->checkpointPath = NULL;
+    }
+    return 0;
 }
 
-int checkBlock(char *input) {
+int checkBlock(char *input, SimConfig *config) {
     if (input == NULL)
     {
         printf(">>> Failed to read Block Size\n");
@@ -229,16 +611,16 @@ int checkBlock(char *input) {
     }
 
     // convert input string to int
-    BLOCK_SIZE = atoi(input);
+    config->blockSize = atoi(input);
 
     // safeguard for bad input
-    if (BLOCK_SIZE <= 0)
+    if (config->blockSize <= 0)
     {
         printf(">>> Block Size must be a positive integer greater than 1\n");
         return -1;
     }
     
-    if (!isPowerOfTwo(BLOCK_SIZE))
+    if (!isPowerOfTwo(config->blockSize))
     {
         printf(">>> Block Size must be a power of 2\n");
         return -1;
@@ -246,7 +628,7 @@ int checkBlock(char *input) {
     return 0;
 }
 
-int checkCacheSize(char *input, int chacheLevel) {
+int checkCacheSize(char *input, int chacheLevel, SimConfig *config) {
     if (input == NULL)
     {
         printf(">>> Failed to read cache size\n");
@@ -255,16 +637,16 @@ int checkCacheSize(char *input, int chacheLevel) {
 
     // convert input string to int
     if (chacheLevel == 1) {
-        L1_CACHE_SIZE = atoi(input);
-        if (L1_CACHE_SIZE < 0)
+        config->cacheSize[0] = atoi(input);
+        if (config->cacheSize[0] < 0)
         {
             printf(">>> L1 Cache size must be a non negative integer\n");
             return -1;
         }
     }
     else if (chacheLevel == 2) {
-        L2_CACHE_SIZE = atoi(input);
-        if (L1_CACHE_SIZE < 0)
+        config->cacheSize[1] = atoi(input);
+        if (config->cacheSize[1] < 0)
         {
             printf(">>> L2 Cache size must be a non negative integer\n");
             return -1;
@@ -273,7 +655,7 @@ int checkCacheSize(char *input, int chacheLevel) {
     return 0;
 }
 
-int checkCacheAssoc(char *input, int assoc) {
+int checkCacheAssoc(char *input, int assoc, SimConfig *config) {
     if (input == NULL)
     {
         printf(">>> Failed to read assoc\n");
@@ -282,16 +664,16 @@ int checkCacheAssoc(char *input, int assoc) {
 
     // convert input string to int
     if (assoc == 1) {
-        L1_ASSOCIATIVITY = atoi(input);
-        if (L1_ASSOCIATIVITY < 0)
+        config->associativity[0] = atoi(input);
+        if (config->associativity[0] < 0)
         {
             printf(">>> L1 assoc must be a non negative integer\n");
             return -1;
         }
     }
     else if (assoc == 2) {
-        L2_ASSOCIATIVITY = atoi(input);
-        if (L1_ASSOCIATIVITY < 0)
+        config->associativity[1] = atoi(input);
+        if (config->associativity[1] < 0)
         {
             printf(">>> L2 assoc must be a non negative integer\n");
             return -1;
@@ -300,73 +682,56 @@ int checkCacheAssoc(char *input, int assoc) {
     return 0;
 }
 
-int checkReplacementPolicy(char *input) {
+int checkReplacementPolicy(char *input, SimConfig *config) {
     if (input == NULL)
     {
         printf(">>> Failed to read replacement policy\n");
         return -1;
     }
 
-    // convert input string to int
-    if (strcmp(input, "LRU") == 0)
-    {
-        REPLACEMENT_POLICY = 1;
-        return 0;
-    }
-    if (strcmp(input, "FIFO") == 0)
+    const ReplacementPolicy *policy = findPolicyByName(input);
+    if (policy != NULL)
     {
-        REPLACEMENT_POLICY = 2;
+        config->replacementPolicy = policy->id;
         return 0;
     }
-    if (strcmp(input, "OPTIMAL") == 0)
-    {
-        REPLACEMENT_POLICY = 3;
-        return 0;
-    }
-    printf(">>> Replacement policy must be LRU, FIFO, or OPTIMAL\n");
+    printf(">>> Replacement policy must be LRU, FIFO, OPTIMAL, PLRU, RANDOM, SRRIP, BRRIP, DRRIP, or LFU\n");
     return -1;
 }
 
-int checkInclusionProperty(char *input) {
+int checkInclusionProperty(char *input, SimConfig *config) {
     if (input == NULL)
     {
         printf(">>> Failed to read inclusion property\n");
         return -1;
     }
 
-    // replace - with space to use strcmp
-    input[3] = ' ';
-
-    if(strcmp(input, "non inclusive") == 0){
-        INCLUSION_PROPERTY = 0;
-        printf("im in non inclusive\n");
-        printf("%s\n", input);
-        printf("%i\n", INCLUSION_PROPERTY);
-        return 0;
+    // any separator between non and inclusive is accepted
+    if(strlen(input) == 13 && strncmp(input, "non", 3) == 0 && strcmp(input + 4, "inclusive") == 0){
+        config->inclusionProperty = 0;
     }else
     {
-        INCLUSION_PROPERTY = 1;
+        config->inclusionProperty = 1;
+    }
+    if (VERBOSE)
+    {
         printf("%s\n", input);
-        printf("%i\n", INCLUSION_PROPERTY);
-
-        return 0;
+        printf("%i\n", config->inclusionProperty);
     }
+    return 0;
     printf(">>> Inclusion property must be inclusive or non-inclusive\n");
     return -1;
 }
 
-int checkTraceFile(char *input) {
+int checkTraceFile(char *input, TraceReader *reader) {
     if (input == NULL)
     {
         printf(">>> Failed to read trace file\n");
         return -1;
     }
 
-    INPUT_FILE = fopen(input, "r");
-    TRACE_FILE_NAME = input;
-
     // check if file opened
-    if (INPUT_FILE == NULL)
+    if (openTrace(reader, input) != 0)
     {
         printf("Could not open file.\n");
         return -1;
@@ -374,305 +739,325 @@ int checkTraceFile(char *input) {
     return 0;
 }
 
-void placeAtFront(Node *temp, int currentLevel, int currentSet){
-    // if list is empty
-    if(MAIN_CACHE[currentLevel]->sets[currentSet].head == NULL){
-        MAIN_CACHE[currentLevel]->sets[currentSet].head = temp;
-        MAIN_CACHE[currentLevel]->sets[currentSet].head->next = NULL;
-        MAIN_CACHE[currentLevel]->sets[currentSet].head->previous = NULL;
-        MAIN_CACHE[currentLevel]->sets[currentSet].tail = temp;   
-        MAIN_CACHE[currentLevel]->sets[currentSet].tail->next = NULL;   
-        MAIN_CACHE[currentLevel]->sets[currentSet].tail->next = NULL;   
-        return ;
-    }
-    // if list is not empty
-    else{
-        temp->next = MAIN_CACHE[currentLevel]->sets[currentSet].head;
-        MAIN_CACHE[currentLevel]->sets[currentSet].head->previous = temp;
-        MAIN_CACHE[currentLevel]->sets[currentSet].head = temp;
-        MAIN_CACHE[currentLevel]->sets[currentSet].head->previous = NULL;
-        return ;
+// "LEVEL,KIND[,DEGREE[,DISTANCE]]" for --prefetch, KIND is next, stride, or stream
+int checkPrefetch(char *input, SimConfig *config) {
+    int level = 0;
+    char kind[16];
+    int degree = 1;
+    int distance = 1;
+    if (sscanf(input, "%d,%15[^,],%d,%d", &level, kind, &degree, &distance) < 2 || level < 1 || level > MAX_LEVELS)
+    {
+        printf(">>> --prefetch takes LEVEL,KIND[,DEGREE[,DISTANCE]] with LEVEL 1 or 2\n");
+        return -1;
     }
-
-}
-
-void LRUPolicy(Node *temp, int currentLevel, int currentSet){
-
-    Node *current = MAIN_CACHE[currentLevel]->sets[currentSet].head;
-    while (current != NULL)
+    int prefetcher = PREFETCH_NONE;
+    for (int i = PREFETCH_NEXT_LINE; i <= PREFETCH_STREAM; i++)
     {
-        if(current->data.tag == temp->data.tag){
-            //if the entry is already in the list
-            if(current->previous == NULL){
-                return;
-            }
-            //if the entry is at the end of the list
-            if(current->next == NULL){
-                MAIN_CACHE[currentLevel]->sets[currentSet].tail = current->previous;
-                MAIN_CACHE[currentLevel]->sets[currentSet].tail->next = NULL;
-                current->previous = NULL;
-                current->next = MAIN_CACHE[currentLevel]->sets[currentSet].head;
-                MAIN_CACHE[currentLevel]->sets[currentSet].head->previous = current;
-                MAIN_CACHE[currentLevel]->sets[currentSet].head = current;
-                return;
-            }
-            //if the entry is in the middle of the list
-            if(current->previous != NULL && current->next != NULL){
-                current->previous->next = current->next;
-                current->next->previous = current->previous;
-                current->previous = NULL;
-                current->next = MAIN_CACHE[currentLevel]->sets[currentSet].head;
-                MAIN_CACHE[currentLevel]->sets[currentSet].head->previous = current;
-                MAIN_CACHE[currentLevel]->sets[currentSet].head = current;
-                return;
-            }
+        if (strcmp(kind, prefetcherName(i)) == 0)
+        {
+            prefetcher = i;
         }
-        current = current->next;
-    }  
-    return;
-}
-
-void inclusion(int currentLevel, int operation, Block *blockAddress){
-    Node *newNode = (Node*)malloc(sizeof(Node));
-
-    newNode->data = blockAddress[currentLevel];
-
-    newNode->next = NULL;
-    newNode->previous = NULL;
-    // if the current tag is 0x80039 and index is 126, print that info
-    if (blockAddress[currentLevel].tag == 0x80039 && blockAddress[currentLevel].index == 126) {
-        printf("%x, index %i\n", blockAddress[currentLevel].tag , blockAddress[currentLevel].index);
     }
-
-    placeAtFront(newNode, currentLevel, blockAddress[currentLevel].index);
-    //increase size
-    MAIN_CACHE[currentLevel]->sets[blockAddress[currentLevel].index].size += 1; 
-    // if our set is to large we know we need to evict
-    if (blockAddress[currentLevel].tag == 0x80039 && blockAddress[currentLevel].index == 126) {
-        printf("%x, index %i\n", blockAddress[currentLevel].tag , blockAddress[currentLevel].index);
+    if (prefetcher == PREFETCH_NONE)
+    {
+        printf(">>> Prefetcher must be next, stride, or stream\n");
+        return -1;
     }
-
-    if(MAIN_CACHE[currentLevel]->sets[blockAddress[currentLevel].index].size > MAIN_CACHE[currentLevel]->sets[blockAddress[currentLevel].index].capacity){
-        // evict LRU node
-        if (blockAddress[currentLevel].tag == 0x80039 && blockAddress[currentLevel].index == 126) {
-            printf("%x, index %i\n", blockAddress[currentLevel].tag , blockAddress[currentLevel].index);
-        }
-        evictBlock(currentLevel, blockAddress);
+    if (degree < 1 || degree > MAX_PREFETCH_DEGREE || distance < 1)
+    {
+        printf(">>> Prefetch degree must be 1 to %i and distance at least 1\n", MAX_PREFETCH_DEGREE);
+        return -1;
     }
+    config->prefetcher[level - 1] = prefetcher;
+    config->prefetchDegree[level - 1] = degree;
+    config->prefetchDistance[level - 1] = distance;
+    return 0;
 }
 
-void evictBlock(int currentLevel, Block *blockAddress){
-    Node *deleteNode = MAIN_CACHE[currentLevel]->sets[blockAddress[currentLevel].index].tail;
-    deleteNode->previous->next = NULL;
-    MAIN_CACHE[currentLevel]->sets[blockAddress[currentLevel].index].tail = deleteNode->previous;
-    MAIN_CACHE[currentLevel]->sets[blockAddress[currentLevel].index].size -= 1;
-    // update access traffic to memory
-    if (deleteNode->data.dirtyBit == 1) {
-        memoryTraffic += 1;
-        writeBacks[currentLevel] += 1;
-    }
-    
-    // if we are not at the bottom level
-    if(currentLevel < 1){
-        inclusion(currentLevel + 1, deleteNode->data.dirtyBit, blockAddress);
+const char *policyName(int replacementPolicy) {
+    // reports have always spelled it this way
+    if (replacementPolicy == POLICY_OPTIMAL)
+    {
+        return "Optimal";
     }
-    
-    printf("evicting: %x, %i\n", deleteNode->data.tag , deleteNode->data.index);
-
-    free(deleteNode);
+    const ReplacementPolicy *policy = findPolicy(replacementPolicy);
+    return policy != NULL ? policy->name : "unknown";
 }
 
-//cycles levels, determines if tag we are looking for is there
-void checkTag(int operation, Block *blockAddress){
-    int found = 0;
-    // check each cache level
-    for (int currentLevel = 0; currentLevel < TOTAL_LEVELS; currentLevel++){
-
-        // ptr being the head of the set in the cache
-        Node *ptr = MAIN_CACHE[currentLevel]->sets[blockAddress[currentLevel].index].head;
-        if(found == 1 && operation == 1){
-            operation = 0;
-            found = 0;
-        }
-        while(ptr != NULL){
-            //if found in cache
-            // if not found before in a previous level
-            if(ptr->data.tag == blockAddress[currentLevel].tag){
-                // update read or write count
-                if(operation == 0){
-                    reads[currentLevel] += 1;
-                }
-                else{
-                    writes[currentLevel] += 1;
-                    // if write op
-                    ptr->data.dirtyBit = 1;
-                }
-                //mark as found
-                found = 1;
-                //if not head
-                if(ptr->previous != NULL){
-                    //move to head
-                    LRUPolicy(ptr, currentLevel, blockAddress[currentLevel].index);
-                }
-            }
-            ptr = ptr->next;
-        }
-        //if not in cache
-        if (found == 0){
-            //update miss count
-            if(NUM_CACHE_SETS[currentLevel] == 0){
-                continue;
-            }
-            if(operation == 0){
-                readMisses[currentLevel] += 1;
-            }
-            else{
-                writeMisses[currentLevel] += 1;
-            }
-            inclusion(currentLevel, operation, blockAddress);
-            // update access traffic to memory
-            memoryTraffic += 1;
+// coverage is the share of the misses a prefetcher-less level would have
+// taken that prefetched blocks served instead
+void printPrefetch(Simulator *sim) {
+    SimStats *stats = &sim->stats;
+    for (int i = 0; i < sim->totalLevels; i++)
+    {
+        if (sim->prefetchers[i] == NULL)
+        {
+            continue;
         }
+        long long misses = i == 0 ? stats->readMisses[0] + stats->writeMisses[0] : stats->readMisses[1];
+        long long useful = stats->usefulPrefetches[i];
+        printf("===== L%d prefetcher (%s, degree %d, distance %d) =====\n", i + 1, prefetcherName(sim->config.prefetcher[i]),
+               sim->config.prefetchDegree[i], sim->config.prefetchDistance[i]);
+        printf("prefetches:                   %lld\n", stats->prefetches[i]);
+        printf("useful prefetches:            %lld\n", useful);
+        printf("evicted unused:               %lld\n", stats->uselessPrefetches[i]);
+        printf("accuracy:                     %f\n", stats->prefetches[i] == 0 ? 0 : (double)useful / stats->prefetches[i]);
+        printf("coverage:                     %f\n", useful + misses == 0 ? 0 : (double)useful / (useful + misses));
+    }
+    if (sim->prefetchers[0] != NULL || sim->prefetchers[1] != NULL)
+    {
+        printf("prefetch memory traffic:      %lld of %lld\n", stats->prefetchTraffic, stats->memoryTraffic);
     }
 }
 
-Block *createMemoryAddress(int operation, unsigned long long int address, int* NUM_CACHE_SETS){
-    
-    Block *block = (Block*)malloc(sizeof(Block) * TOTAL_LEVELS); 
-    for (int i = 0; i < TOTAL_LEVELS; i++){
-        int tagBits = log2(BLOCK_SIZE) + log2(MAIN_CACHE[i]->numSets);
-        int blockOffset = log2(BLOCK_SIZE);
-        int indexBits = log2(MAIN_CACHE[i]->numSets);
-        //produce mask to extract the offset bits
-        int offset = address & ((1 << blockOffset)-1);
-        //remove offset bits value from address but keep length
-        address = address ^ offset;
-        // shift address by offset and & with mask to get index
-        int index = (address >> (blockOffset)) & ((1 << indexBits)-1);
-
-        //extract tag bits by shifting
-        unsigned long long int tag = address >> tagBits;
-        // initialize 
-        // if not read
-        block[i].index = index;
-        block[i].validBit = 1;
-        block[i].offset = offset;
-        block[i].tag = tag;
-        if (operation == 1){
-            block[i].dirtyBit = 1;
-        }else {
-            block[i].dirtyBit = 0;
-        }
-    }
-    return block;
-}
-
-// A utility function to create a cache level
-CacheLevel *createCacheLevel(int level, int cacheSize, int associativity, int numSets) {
-    CacheLevel *cache = (CacheLevel *)malloc(sizeof(CacheLevel));
-    cache->level = level;
-    cache->cacheSize = cacheSize;
-    cache->associativity = associativity;
-    cache->numSets = numSets;
-    
-    cache->sets = (Set *)malloc(sizeof(Set) * numSets);
-    for (int i = 0; i < numSets; i++){
-        cache->sets[i].size = 0;
-        cache->sets[i].capacity = associativity;
-        cache->sets[i].head = NULL;
-        cache->sets[i].tail = NULL;        
+// mean occupancy is over every access, the hits are L1 misses that did not
+// have to go to the level below
+void printBuffers(Simulator *sim) {
+    SimStats *stats = &sim->stats;
+    long long accesses = stats->reads[0] + stats->writes[0];
+    if (sim->victims != NULL)
+    {
+        long long misses = stats->readMisses[0] + stats->writeMisses[0];
+        printf("===== Victim cache (%d entries) =====\n", sim->victims->capacity);
+        printf("hits:                         %lld\n", stats->victimHits);
+        printf("share of L1 misses served:    %f\n", misses == 0 ? 0 : (double)stats->victimHits / misses);
+        printf("mean occupancy:               %f\n", accesses == 0 ? 0 : (double)stats->victimOccupancy / accesses);
+    }
+    if (sim->writeBackBuffer != NULL)
+    {
+        printf("===== Write-back buffer (%d entries) =====\n", sim->writeBackBuffer->capacity);
+        printf("hits:                         %lld\n", stats->writeBackHits);
+        printf("coalesced write-backs:        %lld\n", stats->writeBackCoalesced);
+        printf("drained to the next level:    %lld\n", stats->writeBackDrains);
+        printf("left in the buffer:           %i\n", sim->writeBackBuffer->count);
+        printf("mean occupancy:               %f\n", accesses == 0 ? 0 : (double)stats->writeBackOccupancy / accesses);
     }
-
-    return cache;
 }
 
-void printInfo() {
+void printInfo(Simulator *sim, const char *traceFileName) {
     printf("===== Simulator configuration =====\n");
     // Block size
-    printf("BLOCKSIZE:\t\t%d\n", BLOCK_SIZE);
+    printf("BLOCKSIZE:\t\t%d\n", sim->config.blockSize);
 
     // Cache specific prints
     int num_of_cache_levels = 2;
     for (int i = 0; i < num_of_cache_levels; i++)
     {
-        printf("L%d_SIZE:\t\t%d\n", MAIN_CACHE[i]->level, MAIN_CACHE[i]->cacheSize);
-        printf("L%d_ASSOC:\t\t%d\n", MAIN_CACHE[i]->level, MAIN_CACHE[i]->associativity);
+        printf("L%d_SIZE:\t\t%d\n", sim->levels[i]->level, sim->levels[i]->cacheSize);
+        printf("L%d_ASSOC:\t\t%d\n", sim->levels[i]->level, sim->levels[i]->associativity);
     }
 
     // Replacement Policy
-    if (REPLACEMENT_POLICY == 1)
-    {
-        printf("REPLACEMENT POLICY:\tLRU\n");
-    }
-    else if (REPLACEMENT_POLICY == 2)
-    {
-        printf("REPLACEMENT POLICY:\tFIFO\n");
-    }
-    else if (REPLACEMENT_POLICY == 3)
-    {
-        printf("REPLACEMENT POLICY:\tOptimal\n");
-    }
+    printf("REPLACEMENT POLICY:\t%s\n", policyName(sim->config.replacementPolicy));
 
     // Inclusion Policy
-    printf("%i\n", INCLUSION_PROPERTY);
-    if(INCLUSION_PROPERTY == 0){
+    if(sim->config.inclusionProperty == 0){
         printf("INCLUSION PROPERTY:\tnon-inclusive\n");
     }
     else{
         printf("INCLUSION PROPERTY:\tinclusive\n");
     }
+
+    for (int i = 0; i < sim->totalLevels; i++)
+    {
+        if (sim->config.prefetcher[i] != PREFETCH_NONE)
+        {
+            printf("L%d_PREFETCHER:\t\t%s, degree %d, distance %d\n", i + 1, prefetcherName(sim->config.prefetcher[i]),
+                   sim->config.prefetchDegree[i], sim->config.prefetchDistance[i]);
+        }
+    }
+    if (sim->victims != NULL)
+    {
+        printf("VICTIM CACHE:\t\t%d\n", sim->victims->capacity);
+    }
+    if (sim->writeBackBuffer != NULL)
+    {
+        printf("WRITEBACK BUFFER:\t%d\n", sim->writeBackBuffer->capacity);
+    }
     
     // Trace File
-    printf("trace_file:\t\t%s\n", TRACE_FILE_NAME);
+    printf("trace_file:\t\t%s\n", traceFileName);
 
     // printf("----------------------------------------\n");
 
 }
 
-void printSet(int setNum, int level) {
-    Node *current = MAIN_CACHE[level]->sets[setNum].head;
-    while (current != NULL)
+void printSet(Simulator *sim, int setNum, int level) {
+    CacheLevel *cache = sim->levels[level];
+    for (int way = 0; way < cache->associativity; way++)
     {
-        printf("Tag: %x, Index: %i dirty? %i -> ", current->data.tag, current->data.index, current->data.dirtyBit);
-        current = current->next;
+        int slot = setNum * cache->associativity + way;
+        if (cache->tags[slot] != INVALID_TAG)
+        {
+            printf("Tag: %llx, Index: %i dirty? %i -> ", cache->tags[slot], setNum, cache->dirty[slot]);
+        }
     }
     printf("\n");
 }
 
-void printCache() {
+void printCache(Simulator *sim) {
+    SimStats *stats = &sim->stats;
     // print the main cache to check if it works
-    // print out blocks in each set and cache
+    // print out blocks in each set and cache, in way order
 
-    for (int i = 0; i < TOTAL_LEVELS; i++)
+    for (int i = 0; i < sim->totalLevels; i++)
     {
+        CacheLevel *cache = sim->levels[i];
         printf("===== L%d contents =====\n", (i + 1));
-        for (int j = 0; j < MAIN_CACHE[i]->numSets; j++){
-            if(MAIN_CACHE[i]->sets[j].head != NULL){
-                printf("Set %4i: ", j);
-                Node *ptr = MAIN_CACHE[i]->sets[j].head;
-                while(ptr != NULL){
-                    printf("%7x %c ", ptr->data.tag, ptr->data.dirtyBit == 1 ? 'D' : ' ');
-                    ptr = ptr->next;
+        for (int j = 0; j < cache->storedSets; j++){
+            unsigned long long *tags = &cache->tags[j * cache->associativity];
+            unsigned char *dirty = &cache->dirty[j * cache->associativity];
+            int occupied = 0;
+            for (int way = 0; way < cache->associativity; way++){
+                occupied |= tags[way] != INVALID_TAG;
+            }
+            if(!occupied){
+                continue;
+            }
+            char label[16];
+            snprintf(label, sizeof(label), "%i:", cache->slotSet != NULL ? cache->slotSet[j] : j);
+            printf("Set     %-8s", label);
+            for (int way = 0; way < cache->associativity; way++){
+                if(tags[way] == INVALID_TAG){
+                    continue;
                 }
-                printf("\n");
+                char entry[32];
+                snprintf(entry, sizeof(entry), "%llx %c", tags[way], dirty[way] == 1 ? 'D' : ' ');
+                printf("%-10s", entry);
             }
+            printf("\n");
         }
     }
     printf("===== Simulation results (raw) =====\n");
-    printf("a. number of L1 reads:        %i\n", reads[0]);
-    printf("b. number of L1 read misses:  %i\n", readMisses[0]);
-    printf("c. number of L1 writes:       %i\n", writes[0]);
-    printf("d. number of L1 write misses: %i\n", writeMisses[0]);
-    printf("e. L1 miss rate:              %f\n", missRate[0]);
-    printf("f. number of L1 writebacks:   %i\n", writeBacks[0]);
-    printf("g. number of L2 reads:        %i\n", reads[1]);
-    printf("h. number of L2 read misses:  %i\n", readMisses[1]);
-    printf("i. number of L2 writes:       %i\n", writeMisses[1]);
-    printf("j. number of L2 write misses: %i\n", writeMisses[1]);
-    printf("k. L2 miss rate:              %f\n", missRate[1]);
-    printf("l. number of L2 writebacks:   %i\n", writeBacks[1]);
-    printf("m. total memory traffic:      %i\n", memoryTraffic);    
-    printf("number of sets: %i\n", NUM_CACHE_SETS[0]);
-    printf("number of sets: %i\n", NUM_CACHE_SETS[1]);
-
-}
\ No newline at end of file
+    printf("a. number of L1 reads:        %lld\n", stats->reads[0]);
+    printf("b. number of L1 read misses:  %lld\n", stats->readMisses[0]);
+    printf("c. number of L1 writes:       %lld\n", stats->writes[0]);
+    printf("d. number of L1 write misses: %lld\n", stats->writeMisses[0]);
+    printf("e. L1 miss rate:              %f\n", stats->missRate[0]);
+    printf("f. number of L1 writebacks:   %lld\n", stats->writeBacks[0]);
+    printf("g. number of L2 reads:        %lld\n", stats->reads[1]);
+    printf("h. number of L2 read misses:  %lld\n", stats->readMisses[1]);
+    printf("i. number of L2 writes:       %lld\n", stats->writes[1]);
+    printf("j. number of L2 write misses: %lld\n", stats->writeMisses[1]);
+    if (sim->totalLevels > 1) {
+        printf("k. L2 miss rate:              %f\n", stats->missRate[1]);
+    } else {
+        printf("k. L2 miss rate:              0\n");
+    }
+    printf("l. number of L2 writebacks:   %lld\n", stats->writeBacks[1]);
+    printf("m. total memory traffic:      %lld\n", stats->memoryTraffic);    
+    printf("number of sets: %i\n", sim->numSets[0]);
+    printf("number of sets: %i\n", sim->numSets[1]);
+
+}
+
+void printSetSampleEstimate(Simulator *sim) {
+    // the sampled groups are a simple random sample of all of them
+    const Sample *groups = sim->groups;
+    int n = sim->sampledGroups;
+    double fraction = (double)n / sim->numGroups;
+    double estimate, halfWidth;
+
+    printf("===== Set sampled estimate (1 in %d sets, 95%% confidence) =====\n", sim->config.setSampling);
+    for (int i = 0; i < sim->totalLevels; i++)
+    {
+        printf("L%d sets simulated:             %i of %i\n", i + 1, sim->levels[i]->storedSets, sim->numSets[i]);
+    }
+    double simulated = 0;
+    for (int i = 0; i < n; i++)
+    {
+        simulated += groups[i].value[L1_ACCESSES];
+    }
+    printf("accesses simulated:           %.0f of %zu\n", simulated, sim->position);
+    ratioEstimate(groups, n, L1_MISSES, L1_ACCESSES, fraction, &estimate, &halfWidth);
+    printf("L1 miss rate:                 %f +- %f\n", estimate, halfWidth);
+    if (sim->totalLevels > 1)
+    {
+        ratioEstimate(groups, n, L2_READ_MISSES, L2_READS, fraction, &estimate, &halfWidth);
+        printf("L2 miss rate:                 %f +- %f\n", estimate, halfWidth);
+    }
+    totalEstimate(groups, n, WRITE_BACKS, sim->numGroups, &estimate, &halfWidth);
+    printf("L1 + L2 writebacks:           %.0f +- %.0f\n", estimate, halfWidth);
+    totalEstimate(groups, n, MEMORY_TRAFFIC, sim->numGroups, &estimate, &halfWidth);
+    printf("total memory traffic:         %.0f +- %.0f\n", estimate, halfWidth);
+}
+
+#ifdef MISS_CLASSES
+void printMissProfile(Simulator *sim) {
+    for (int i = 0; i < sim->totalLevels; i++)
+    {
+        MissProfile *profile = sim->profiles[i];
+        long long misses = profile->compulsory + profile->capacity + profile->conflict;
+        printf("===== L%d miss classes =====\n", i + 1);
+        printf("compulsory: %lld (%.2f%%)\n", profile->compulsory, misses == 0 ? 0 : 100.0 * profile->compulsory / misses);
+        printf("capacity:   %lld (%.2f%%)\n", profile->capacity, misses == 0 ? 0 : 100.0 * profile->capacity / misses);
+        printf("conflict:   %lld (%.2f%%)\n", profile->conflict, misses == 0 ? 0 : 100.0 * profile->conflict / misses);
+
+        // how many sets took 0, 1, 2-3, 4-7, ... misses
+        int buckets[63] = {0};
+        int highest = 0;
+        for (int set = 0; set < profile->numSets; set++)
+        {
+            int bucket = 0;
+            while (bucket < 62 && (1LL << bucket) <= profile->setMisses[set])
+            {
+                bucket++;
+            }
+            buckets[bucket]++;
+            if (bucket > highest)
+            {
+                highest = bucket;
+            }
+        }
+        printf("===== L%d misses per set =====\n", i + 1);
+        for (int bucket = 0; bucket <= highest; bucket++)
+        {
+            if (buckets[bucket] == 0)
+            {
+                continue;
+            }
+            char range[48];
+            if (bucket == 0)
+            {
+                snprintf(range, sizeof(range), "0:");
+            }
+            else
+            {
+                snprintf(range, sizeof(range), "%lld-%lld:", 1LL << (bucket - 1), (1LL << bucket) - 1);
+            }
+            printf("%-16s%i sets\n", range, buckets[bucket]);
+        }
+
+        // the sets with the most evictions, ties to the lower set
+        printf("===== L%d most thrashed sets =====\n", i + 1);
+        printf("set\taccesses\tmisses\tevictions\tmiss rate\n");
+        int listed[MISS_TOP_SETS];
+        int count = 0;
+        while (count < MISS_TOP_SETS && count < profile->numSets)
+        {
+            int best = -1;
+            for (int set = 0; set < profile->numSets; set++)
+            {
+                int taken = 0;
+                for (int j = 0; j < count; j++)
+                {
+                    taken |= listed[j] == set;
+                }
+                if (!taken && (best < 0 || profile->setEvictions[set] > profile->setEvictions[best]))
+                {
+                    best = set;
+                }
+            }
+            if (profile->setEvictions[best] == 0)
+            {
+                break;
+            }
+            listed[count++] = best;
+            // set sampled levels keep their counters per stored slot
+            int set = sim->levels[i]->slotSet != NULL ? sim->levels[i]->slotSet[best] : best;
+            printf("%i\t%lld\t\t%lld\t%lld\t\t%f\n", set, profile->setAccesses[best], profile->setMisses[best],
+                   profile->setEvictions[best], (double)profile->setMisses[best] / profile->setAccesses[best]);
+        }
+    }
+}
+#endif
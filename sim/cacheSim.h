@@ -0,0 +1,32 @@
+// command line checks and report printing shared by the cacheSim modes
+
+#ifndef CACHE_SIM_H
+#define CACHE_SIM_H
+
+#include "cacheEngine.h"
+
+// per access and per eviction debug output, enabled with --verbose
+extern int VERBOSE;
+
+int checkBlock(char *input, SimConfig *config);
+int checkCacheSize(char *input, int chacheLevel, SimConfig *config);
+int checkCacheAssoc(char *input, int assoc, SimConfig *config);
+int checkReplacementPolicy(char *input, SimConfig *config);
+int checkInclusionProperty(char *input, SimConfig *config);
+int checkPrefetch(char *input, SimConfig *config);
+const char *policyName(int replacementPolicy);
+
+void printSet(Simulator *sim, int setIndex, int cacheLevel);
+void printInfo(Simulator *sim, const char *traceFileName);
+void printCache(Simulator *sim);
+// --set-sample results, extrapolated from the sampled set groups
+void printSetSampleEstimate(Simulator *sim);
+// accuracy, coverage, and traffic of the levels that have a prefetcher
+void printPrefetch(Simulator *sim);
+// hits and occupancy of the victim cache and write-back buffer
+void printBuffers(Simulator *sim);
+#ifdef MISS_CLASSES
+void printMissProfile(Simulator *sim);
+#endif
+
+#endif
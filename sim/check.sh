@@ -0,0 +1,67 @@
+#!/bin/sh
+# make check, replays every sim/validation_runs file through ./cacheSim with
+# the configuration in its header and diffs the cache contents and counters
+
+status=0
+for expected in validation_runs/validation*.txt
+do
+    # the header holds the run's arguments, one "NAME: value" line each
+    field() { sed -n "s/^$1:[[:space:]]*//p" "$expected" | head -n 1; }
+    policy=$(field "REPLACEMENT POLICY" | tr 'a-z' 'A-Z')
+    args="$(field BLOCKSIZE) $(field L1_SIZE) $(field L1_ASSOC) $(field L2_SIZE) $(field L2_ASSOC) $policy $(field "INCLUSION PROPERTY") traces/$(field trace_file)"
+
+    # compare from the contents to the last counter, trailing blanks ignored
+    ./cacheSim $args | sed -n '/===== L1 contents/,/m\. total memory traffic/p' | sed 's/[[:space:]]*$//' > check.out
+    sed -n '/===== L1 contents/,/m\. total memory traffic/p' "$expected" | sed 's/[[:space:]]*$//' > check.expected
+
+    if diff check.expected check.out > check.diff
+    then
+        echo "PASS $expected"
+    else
+        echo "FAIL $expected ($args)"
+        head -n 10 check.diff
+        status=1
+    fi
+done
+rm -f check.out check.expected check.diff
+
+# a read only trace writes nothing back, so the write buffer must never fill
+# however much the prefetcher fetches from memory
+stalls=$(sed 's/^w/r/' traces/gcc_trace.txt |
+    ./cacheSim --timing 1,10,100 --prefetch 1,next,2,1 16 1024 2 8192 4 LRU inclusive - |
+    sed -n 's/^[[:space:]]*write buffer full:[[:space:]]*//p')
+if [ "$stalls" = 0 ]
+then
+    echo "PASS timing with a prefetcher"
+else
+    echo "FAIL timing with a prefetcher (write buffer full for $stalls cycles on a read only trace)"
+    status=1
+fi
+
+# with one level every L1 miss the buffers beside it did not serve is a
+# fetch, so the timed writes to memory are the rest of the memory traffic
+./cacheSim --timing 1,10,100 --victim-cache 4 --writeback-buffer 4 16 1024 1 0 0 LRU non-inclusive traces/gcc_trace.txt > check.out
+field() { sed -n "s/^$1:[[:space:]]*//p" check.out; }
+fetched=$(( $(field "b. number of L1 read misses") + $(field "d. number of L1 write misses") - $(field hits | awk '{ s += $1 } END { print s + 0 }') ))
+writes=$(( $(field "m. total memory traffic") - fetched ))
+if [ "$(field "writes to memory")" = "$writes" ]
+then
+    echo "PASS timing with buffers beside a single level"
+else
+    echo "FAIL timing with buffers beside a single level ($(field "writes to memory") writes to memory, $writes written back)"
+    status=1
+fi
+rm -f check.out
+
+# prefetches taking blocks back from the victim cache are no L1 misses, so
+# the share of the misses it served stays at most 1
+share=$(./cacheSim --victim-cache 16 --prefetch 1,next,4,1 32 1024 1 0 0 LRU non-inclusive traces/go_trace.txt |
+    sed -n 's/^share of L1 misses served:[[:space:]]*//p')
+if awk "BEGIN { exit !(\"$share\" != \"\" && $share <= 1) }"
+then
+    echo "PASS victim cache with a prefetcher"
+else
+    echo "FAIL victim cache with a prefetcher (served a $share share of the L1 misses)"
+    status=1
+fi
+exit $status
@@ -0,0 +1,234 @@
+// checkpoint files, written and read field by field so the layout does not
+// depend on struct padding or byte order. MISS_CLASSES profiles are not
+// saved and restart from the restored position.
+#include <stdio.h>
+#include <string.h>
+#include "checkpoint.h"
+#include "policy.h"
+#include "traceReader.h"
+
+static void putValue(FILE *file, unsigned long long value, int length)
+{
+    for (int i = 0; i < length; i++)
+    {
+        fputc((value >> (8 * i)) & 0xff, file);
+    }
+}
+
+// returns 0 once the file runs out, value is then left at 0
+static int getValue(FILE *file, unsigned long long *value, int length)
+{
+    unsigned char bytes[8];
+    *value = 0;
+    if (fread(bytes, 1, length, file) != (size_t)length)
+    {
+        return 0;
+    }
+    *value = readLittleEndian(bytes, length);
+    return 1;
+}
+
+// the counters in file order
+static long long *statCounters(SimStats *stats, int level, int index)
+{
+    long long *counters[] = {
+        &stats->reads[level], &stats->readMisses[level], &stats->writes[level], &stats->writeMisses[level],
+        &stats->writeBacks[level], &stats->writeThroughs[level], &stats->cacheToCacheTransfers[level],
+    };
+    return counters[index];
+}
+
+#define LEVEL_COUNTERS 7
+
+static void configFields(const SimConfig *config, unsigned long long *fields)
+{
+    fields[0] = config->blockSize;
+    fields[1] = config->cacheSize[0];
+    fields[2] = config->associativity[0];
+    fields[3] = config->cacheSize[1];
+    fields[4] = config->associativity[1];
+    fields[5] = config->replacementPolicy;
+    fields[6] = config->inclusionProperty;
+}
+
+int saveCheckpoint(const Simulator *sim, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    fwrite(CHECKPOINT_MAGIC, 1, 4, file);
+    putValue(file, CHECKPOINT_VERSION, 4);
+    unsigned long long fields[7];
+    configFields(&sim->config, fields);
+    for (int i = 0; i < 7; i++)
+    {
+        putValue(file, fields[i], 4);
+    }
+    putValue(file, sim->position, 8);
+    SimStats stats = sim->stats;
+    for (int level = 0; level < MAX_LEVELS; level++)
+    {
+        for (int i = 0; i < LEVEL_COUNTERS; i++)
+        {
+            putValue(file, *statCounters(&stats, level, i), 8);
+        }
+    }
+    putValue(file, sim->stats.memoryTraffic, 8);
+
+    for (int level = 0; level < sim->totalLevels; level++)
+    {
+        CacheLevel *cache = sim->levels[level];
+        int numWays = cache->storedSets * cache->associativity;
+        for (int way = 0; way < numWays; way++)
+        {
+            putValue(file, cache->tags[way], 8);
+            putValue(file, cache->dirty[way], 1);
+            putValue(file, cache->rank[way], 2);
+            if (cache->heap != NULL)
+            {
+                putValue(file, cache->nextUse[way], 8);
+                putValue(file, cache->heap[way], 2);
+                putValue(file, cache->heapIndex[way], 2);
+            }
+        }
+        if (cache->heap != NULL)
+        {
+            for (int set = 0; set < cache->storedSets; set++)
+            {
+                putValue(file, cache->heapCount[set], 2);
+            }
+        }
+        if (cache->plru != NULL)
+        {
+            for (int set = 0; set < cache->storedSets; set++)
+            {
+                putValue(file, cache->plru[set], 8);
+            }
+        }
+        if (cache->wayState != NULL)
+        {
+            for (int way = 0; way < numWays; way++)
+            {
+                putValue(file, cache->wayState[way], 1);
+            }
+        }
+        if (cache->policy->levelState)
+        {
+            putValue(file, cache->psel, 4);
+            putValue(file, cache->fills, 4);
+            putValue(file, cache->random, 8);
+        }
+    }
+
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int loadCheckpoint(Simulator *sim, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return CHECKPOINT_BAD_FILE;
+    }
+
+    char magic[4];
+    unsigned long long value;
+    int ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, CHECKPOINT_MAGIC, 4) == 0 &&
+             getValue(file, &value, 4) && value >= 1 && value <= CHECKPOINT_VERSION;
+    if (!ok)
+    {
+        fclose(file);
+        return CHECKPOINT_BAD_FILE;
+    }
+    unsigned long long fields[7];
+    configFields(&sim->config, fields);
+    for (int i = 0; i < 7; i++)
+    {
+        ok &= getValue(file, &value, 4);
+        if (ok && value != fields[i])
+        {
+            fclose(file);
+            return CHECKPOINT_MISMATCH;
+        }
+    }
+
+    ok &= getValue(file, &value, 8);
+    sim->position = value;
+    for (int level = 0; level < MAX_LEVELS; level++)
+    {
+        for (int i = 0; i < LEVEL_COUNTERS; i++)
+        {
+            ok &= getValue(file, &value, 8);
+            *statCounters(&sim->stats, level, i) = value;
+        }
+    }
+    ok &= getValue(file, &value, 8);
+    sim->stats.memoryTraffic = value;
+
+    for (int level = 0; level < sim->totalLevels; level++)
+    {
+        CacheLevel *cache = sim->levels[level];
+        int numWays = cache->storedSets * cache->associativity;
+        for (int way = 0; way < numWays; way++)
+        {
+            ok &= getValue(file, &value, 8);
+            cache->tags[way] = value;
+            ok &= getValue(file, &value, 1);
+            cache->dirty[way] = value;
+            ok &= getValue(file, &value, 2);
+            cache->rank[way] = value;
+            if (cache->heap != NULL)
+            {
+                ok &= getValue(file, &value, 8);
+                cache->nextUse[way] = value;
+                ok &= getValue(file, &value, 2);
+                cache->heap[way] = value;
+                ok &= getValue(file, &value, 2);
+                cache->heapIndex[way] = value;
+            }
+        }
+        if (cache->heap != NULL)
+        {
+            for (int set = 0; set < cache->storedSets; set++)
+            {
+                ok &= getValue(file, &value, 2);
+                cache->heapCount[set] = value;
+            }
+        }
+        if (cache->plru != NULL)
+        {
+            for (int set = 0; set < cache->storedSets; set++)
+            {
+                ok &= getValue(file, &value, 8);
+                cache->plru[set] = value;
+            }
+        }
+        if (cache->wayState != NULL)
+        {
+            for (int way = 0; way < numWays; way++)
+            {
+                ok &= getValue(file, &value, 1);
+                cache->wayState[way] = value;
+            }
+        }
+        if (cache->policy->levelState)
+        {
+            ok &= getValue(file, &value, 4);
+            cache->psel = value;
+            ok &= getValue(file, &value, 4);
+            cache->fills = value;
+            ok &= getValue(file, &value, 8);
+            cache->random = value;
+        }
+    }
+    fclose(file);
+    return ok ? 0 : CHECKPOINT_BAD_FILE;
+}
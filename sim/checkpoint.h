@@ -0,0 +1,37 @@
+// --checkpoint and --restore, the whole state of a Simulator saved to a
+// file at some access of the trace and picked up again from there
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "cacheEngine.h"
+
+// checkpoint layout, all integers little endian
+//   header: "CSCK", u32 version
+//   config: u32 block size, L1 size, L1 assoc, L2 size, L2 assoc, policy, inclusion
+//   u64 trace position, then u64 per SimStats counter of both levels
+//   per level and way: u64 tag, u8 dirty, u16 rank, and for OPTIMAL
+//   u64 next use, u16 heap entry, u16 heap index
+//   per level and set, OPTIMAL only: u16 heap count
+//   per level and set, PLRU only: u64 tree bits
+//   per level and way, policies with way state only: u8 RRPV or LFU count
+//   per level, policies with level state only: u32 PSEL, u32 BRRIP fill
+//   count, u64 RANDOM generator state
+// version 2 added the last two sections, which are only written for the
+// policies that came with them, so version 1 files are read the same way
+#define CHECKPOINT_MAGIC "CSCK"
+#define CHECKPOINT_VERSION 2
+
+// returned by loadCheckpoint besides 0
+#define CHECKPOINT_BAD_FILE -1
+#define CHECKPOINT_MISMATCH -2
+
+// returns 0 or -1 if the file cannot be written
+int saveCheckpoint(const Simulator *sim, const char *path);
+
+// fill sim, created for the same configuration, with a saved state,
+// returns 0, CHECKPOINT_BAD_FILE, or CHECKPOINT_MISMATCH when the
+// checkpoint was taken with another configuration
+int loadCheckpoint(Simulator *sim, const char *path);
+
+#endif
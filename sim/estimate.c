@@ -0,0 +1,64 @@
+// estimators for sampled runs, normal intervals with the finite population
+// correction when the whole population is known
+#include <math.h>
+#include "estimate.h"
+
+void addSampleDelta(Sample *sample, const SimStats *now, const SimStats *before)
+{
+    sample->value[L1_ACCESSES] += now->reads[0] + now->writes[0] - before->reads[0] - before->writes[0];
+    sample->value[L1_MISSES] += now->readMisses[0] + now->writeMisses[0] - before->readMisses[0] - before->writeMisses[0];
+    sample->value[L2_READS] += now->reads[1] - before->reads[1];
+    sample->value[L2_READ_MISSES] += now->readMisses[1] - before->readMisses[1];
+    sample->value[WRITE_BACKS] += now->writeBacks[0] + now->writeBacks[1] - before->writeBacks[0] - before->writeBacks[1];
+    sample->value[MEMORY_TRAFFIC] += now->memoryTraffic - before->memoryTraffic;
+}
+
+void ratioEstimate(const Sample *samples, int n, int numerator, int denominator,
+                   double sampledFraction, double *estimate, double *halfWidth)
+{
+    double top = 0;
+    double bottom = 0;
+    for (int i = 0; i < n; i++)
+    {
+        top += samples[i].value[numerator];
+        bottom += samples[i].value[denominator];
+    }
+    *estimate = bottom == 0 ? 0 : top / bottom;
+    *halfWidth = 0;
+    if (n < 2 || bottom == 0)
+    {
+        return;
+    }
+    double squares = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double residual = samples[i].value[numerator] - *estimate * samples[i].value[denominator];
+        squares += residual * residual;
+    }
+    double meanBottom = bottom / n;
+    *halfWidth = CONFIDENCE_Z * sqrt(squares / (n - 1) / n * (1 - sampledFraction)) / meanBottom;
+}
+
+void totalEstimate(const Sample *samples, int n, int field, int population,
+                   double *estimate, double *halfWidth)
+{
+    double sum = 0;
+    for (int i = 0; i < n; i++)
+    {
+        sum += samples[i].value[field];
+    }
+    double mean = n == 0 ? 0 : sum / n;
+    *estimate = mean * population;
+    *halfWidth = 0;
+    if (n < 2)
+    {
+        return;
+    }
+    double squares = 0;
+    for (int i = 0; i < n; i++)
+    {
+        squares += (samples[i].value[field] - mean) * (samples[i].value[field] - mean);
+    }
+    double fraction = (double)n / population;
+    *halfWidth = CONFIDENCE_Z * population * sqrt(squares / (n - 1) / n * (1 - fraction));
+}
@@ -0,0 +1,42 @@
+// counters of one sample of a sampled run and the estimators with 95%
+// confidence intervals built on them, shared by --sample and --set-sample
+
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include "cacheEngine.h"
+
+// two sided 95% point of the normal distribution
+#define CONFIDENCE_Z 1.96
+
+enum SampleField
+{
+    L1_ACCESSES,
+    L1_MISSES,
+    L2_READS,
+    L2_READ_MISSES,
+    WRITE_BACKS,
+    MEMORY_TRAFFIC,
+    SAMPLE_FIELDS
+};
+
+typedef struct Sample
+{
+    double value[SAMPLE_FIELDS];
+} Sample;
+
+// add what the counters did between before and now to sample
+void addSampleDelta(Sample *sample, const SimStats *now, const SimStats *before);
+
+// ratio of the numerator and denominator sums over n samples, with the
+// half width of its interval from the linearized variance of the per
+// sample residuals, sampledFraction of the population is 0 for an
+// unbounded one and shrinks the interval as it approaches 1
+void ratioEstimate(const Sample *samples, int n, int numerator, int denominator,
+                   double sampledFraction, double *estimate, double *halfWidth);
+
+// population total of one field from n samples drawn out of population
+void totalEstimate(const Sample *samples, int n, int field, int population,
+                   double *estimate, double *halfWidth);
+
+#endif
@@ -0,0 +1,73 @@
+// windowed statistics, each line holds the counter deltas of one window
+// with miss rates computed the way finishSimulation does for the whole run
+#include <string.h>
+#include "interval.h"
+
+int startIntervals(IntervalReport *report, const Simulator *sim, FILE *out, size_t every, const char *format)
+{
+    memset(report, 0, sizeof(*report));
+    report->out = out;
+    report->every = every;
+    report->start = sim->position;
+    report->last = sim->stats;
+    if (strcmp(format, "csv") == 0)
+    {
+        report->format = INTERVAL_CSV;
+        fprintf(out, "window,start,accesses,l1_miss_rate,l2_miss_rate,l1_writebacks,l2_writebacks,memory_traffic\n");
+    }
+    else if (strcmp(format, "json") == 0)
+    {
+        report->format = INTERVAL_JSON;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+size_t intervalRoom(const IntervalReport *report, const Simulator *sim)
+{
+    return report->start + report->every - sim->position;
+}
+
+void reportInterval(IntervalReport *report, const Simulator *sim, int final)
+{
+    size_t accesses = sim->position - report->start;
+    if (accesses == 0 || (accesses < report->every && !final))
+    {
+        return;
+    }
+
+    const SimStats *now = &sim->stats;
+    const SimStats *last = &report->last;
+    long long l1Accesses = now->reads[0] + now->writes[0] - last->reads[0] - last->writes[0];
+    long long l1Misses = now->readMisses[0] + now->writeMisses[0] - last->readMisses[0] - last->writeMisses[0];
+    long long l2Reads = now->reads[1] - last->reads[1];
+    long long l2ReadMisses = now->readMisses[1] - last->readMisses[1];
+    double l1MissRate = l1Accesses == 0 ? 0 : (double)l1Misses / l1Accesses;
+    double l2MissRate = l2Reads == 0 ? 0 : (double)l2ReadMisses / l2Reads;
+    long long l1WriteBacks = now->writeBacks[0] - last->writeBacks[0];
+    long long l2WriteBacks = now->writeBacks[1] - last->writeBacks[1];
+    long long memoryTraffic = now->memoryTraffic - last->memoryTraffic;
+
+    if (report->format == INTERVAL_JSON)
+    {
+        fprintf(report->out,
+                "{\"window\": %i, \"start\": %zu, \"accesses\": %zu, \"l1MissRate\": %f, \"l2MissRate\": %f, "
+                "\"l1WriteBacks\": %lld, \"l2WriteBacks\": %lld, \"memoryTraffic\": %lld}\n",
+                report->window, report->start, accesses, l1MissRate, l2MissRate, l1WriteBacks, l2WriteBacks,
+                memoryTraffic);
+    }
+    else
+    {
+        fprintf(report->out, "%i,%zu,%zu,%f,%f,%lld,%lld,%lld\n", report->window, report->start, accesses, l1MissRate,
+                l2MissRate, l1WriteBacks, l2WriteBacks, memoryTraffic);
+    }
+    // a live pipe should see every window as soon as it is done
+    fflush(report->out);
+
+    report->window++;
+    report->start = sim->position;
+    report->last = *now;
+}
@@ -0,0 +1,36 @@
+// --interval mode, counters of every window of N accesses printed as the
+// trace is simulated so program phases show up while it runs
+
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include <stdio.h>
+#include "cacheEngine.h"
+
+#define INTERVAL_CSV 0
+#define INTERVAL_JSON 1
+
+typedef struct IntervalReport
+{
+    FILE *out;
+    int format;
+    // window length in accesses
+    size_t every;
+    int window;
+    // position and counters where the current window started
+    size_t start;
+    SimStats last;
+} IntervalReport;
+
+// the first window starts where sim is, returns 0, or -1 if format is not
+// "csv" or "json", and prints the csv header
+int startIntervals(IntervalReport *report, const Simulator *sim, FILE *out, size_t every, const char *format);
+
+// accesses sim can take before the current window is full
+size_t intervalRoom(const IntervalReport *report, const Simulator *sim);
+
+// print the window if sim just filled it, or when final is set whatever
+// part of a window it has simulated since the last one
+void reportInterval(IntervalReport *report, const Simulator *sim, int final);
+
+#endif
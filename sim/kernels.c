@@ -0,0 +1,302 @@
+// Specialized versions of the engine's access path. Every helper here is
+// forced inline and takes the way counts, policy, and inclusion property
+// as arguments, and each kernel passes them as literals, so the compiler
+// fully unrolls the set scans and drops the branches that do not apply.
+// The two levels are written out separately instead of recursing through
+// accessLevel, in the same order of events, so counters and set contents
+// match the generic path exactly. OPTIMAL, way counts outside the table,
+// set sampled runs, runs with prefetchers or buffers beside L1, and
+// MISS_CLASSES builds stay on the generic path.
+#include "kernels.h"
+
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
+KERNEL_INLINE int kernelFindWay(const unsigned long long *tags, unsigned long long tag, int assoc)
+{
+    int hitWay = -1;
+    for (int way = 0; way < assoc; way++)
+    {
+        if (tags[way] == tag)
+        {
+            hitWay = way;
+        }
+    }
+    return hitWay;
+}
+
+KERNEL_INLINE int kernelSelectVictim(const unsigned long long *tags, const unsigned short *rank, int assoc)
+{
+    int victim = 0;
+    for (int way = 0; way < assoc; way++)
+    {
+        if (tags[way] == INVALID_TAG)
+        {
+            return way;
+        }
+        if (rank[way] > rank[victim])
+        {
+            victim = way;
+        }
+    }
+    return victim;
+}
+
+KERNEL_INLINE void kernelPromote(unsigned short *rank, int way, int assoc)
+{
+    unsigned short current = rank[way];
+    for (int i = 0; i < assoc; i++)
+    {
+        rank[i] += rank[i] < current;
+    }
+    rank[way] = 0;
+}
+
+// inclusive L2 victim leaving L1, dirty copies go straight to memory
+KERNEL_INLINE void kernelBackInvalidate(Simulator *sim, unsigned long long address, int assoc1)
+{
+    CacheLevel *cache = sim->levels[0];
+    int base = ((address >> cache->offsetBits) & cache->indexMask) * assoc1;
+    int way = kernelFindWay(&cache->tags[base], address >> cache->tagShift, assoc1);
+    if (way < 0)
+    {
+        return;
+    }
+    if (cache->dirty[base + way] == 1)
+    {
+        sim->stats.memoryTraffic += 1;
+    }
+    cache->tags[base + way] = INVALID_TAG;
+    cache->dirty[base + way] = 0;
+}
+
+// one request to L2, the bottom level, misses are filled from memory
+KERNEL_INLINE void kernelLowerAccess(Simulator *sim, int operation, unsigned long long address,
+                                     int assoc1, int assoc2, int policy, int inclusive)
+{
+    CacheLevel *cache = sim->levels[1];
+    SimStats *stats = &sim->stats;
+    int set = (address >> cache->offsetBits) & cache->indexMask;
+    int base = set * assoc2;
+    unsigned long long tag = address >> cache->tagShift;
+    unsigned long long *tags = &cache->tags[base];
+    int way = kernelFindWay(tags, tag, assoc2);
+
+    if (operation == 0)
+    {
+        stats->reads[1] += 1;
+    }
+    else
+    {
+        stats->writes[1] += 1;
+    }
+    if (way >= 0)
+    {
+        if (policy == POLICY_LRU)
+        {
+            kernelPromote(&cache->rank[base], way, assoc2);
+        }
+        if (operation == 1)
+        {
+            cache->dirty[base + way] = 1;
+        }
+        return;
+    }
+
+    if (operation == 0)
+    {
+        stats->readMisses[1] += 1;
+    }
+    else
+    {
+        stats->writeMisses[1] += 1;
+    }
+    way = kernelSelectVictim(tags, &cache->rank[base], assoc2);
+    if (tags[way] != INVALID_TAG)
+    {
+        unsigned long long victim = ((tags[way] << cache->indexBits) | (unsigned long long)set) << cache->offsetBits;
+        if (cache->dirty[base + way] == 1)
+        {
+            stats->writeBacks[1] += 1;
+            stats->memoryTraffic += 1;
+        }
+        tags[way] = INVALID_TAG;
+        cache->dirty[base + way] = 0;
+        if (inclusive)
+        {
+            kernelBackInvalidate(sim, victim, assoc1);
+        }
+    }
+
+    stats->memoryTraffic += 1;
+    tags[way] = tag;
+    cache->dirty[base + way] = operation == 1;
+    kernelPromote(&cache->rank[base], way, assoc2);
+}
+
+// one trace access, assoc2 of 0 is a single level hierarchy
+KERNEL_INLINE void kernelAccess(Simulator *sim, int operation, unsigned long long address,
+                                int assoc1, int assoc2, int policy, int inclusive)
+{
+    CacheLevel *cache = sim->levels[0];
+    SimStats *stats = &sim->stats;
+    int set = (address >> cache->offsetBits) & cache->indexMask;
+    int base = set * assoc1;
+    unsigned long long tag = address >> cache->tagShift;
+    unsigned long long *tags = &cache->tags[base];
+    int way = kernelFindWay(tags, tag, assoc1);
+
+    if (operation == 0)
+    {
+        stats->reads[0] += 1;
+    }
+    else
+    {
+        stats->writes[0] += 1;
+    }
+    if (way >= 0)
+    {
+        if (policy == POLICY_LRU)
+        {
+            kernelPromote(&cache->rank[base], way, assoc1);
+        }
+        if (operation == 1)
+        {
+            cache->dirty[base + way] = 1;
+        }
+        return;
+    }
+
+    if (operation == 0)
+    {
+        stats->readMisses[0] += 1;
+    }
+    else
+    {
+        stats->writeMisses[0] += 1;
+    }
+    way = kernelSelectVictim(tags, &cache->rank[base], assoc1);
+    if (tags[way] != INVALID_TAG)
+    {
+        unsigned long long victim = ((tags[way] << cache->indexBits) | (unsigned long long)set) << cache->offsetBits;
+        int dirty = cache->dirty[base + way];
+        tags[way] = INVALID_TAG;
+        cache->dirty[base + way] = 0;
+        if (dirty == 1)
+        {
+            stats->writeBacks[0] += 1;
+            if (assoc2 > 0)
+            {
+                kernelLowerAccess(sim, 1, victim, assoc1, assoc2, policy, inclusive);
+            }
+            else
+            {
+                stats->memoryTraffic += 1;
+            }
+        }
+    }
+
+    if (assoc2 > 0)
+    {
+        kernelLowerAccess(sim, 0, address, assoc1, assoc2, policy, inclusive);
+    }
+    else
+    {
+        stats->memoryTraffic += 1;
+    }
+    tags[way] = tag;
+    cache->dirty[base + way] = operation == 1;
+    kernelPromote(&cache->rank[base], way, assoc1);
+}
+
+#define KERNEL_NAME(A1, A2, POLICY, INCLUSIVE) kernel_##A1##_##A2##_##POLICY##_##INCLUSIVE
+
+#define DEFINE_KERNEL(A1, A2, POLICY, INCLUSIVE)                                                 \
+    static void KERNEL_NAME(A1, A2, POLICY, INCLUSIVE)(Simulator *sim, const unsigned char *operations, \
+                                                      const unsigned long long *addresses, size_t n) \
+    {                                                                                             \
+        for (size_t i = 0; i < n; i++)                                                            \
+        {                                                                                         \
+            kernelAccess(sim, operations[i], addresses[i], A1, A2, POLICY_##POLICY, INCLUSIVE);   \
+        }                                                                                         \
+        sim->position += n;                                                                       \
+    }
+
+// the table covers L1 ways 1/2/4/8/16 and L2 ways none/1/2/4/8/16
+#define FOR_L2_WAYS(M, A1, POLICY, INCLUSIVE) \
+    M(A1, 0, POLICY, INCLUSIVE) M(A1, 1, POLICY, INCLUSIVE) M(A1, 2, POLICY, INCLUSIVE) \
+    M(A1, 4, POLICY, INCLUSIVE) M(A1, 8, POLICY, INCLUSIVE) M(A1, 16, POLICY, INCLUSIVE)
+#define FOR_L1_WAYS(M, POLICY, INCLUSIVE) \
+    M(1, POLICY, INCLUSIVE) M(2, POLICY, INCLUSIVE) M(4, POLICY, INCLUSIVE) \
+    M(8, POLICY, INCLUSIVE) M(16, POLICY, INCLUSIVE)
+
+#define DEFINE_KERNEL_ROW(A1, POLICY, INCLUSIVE) FOR_L2_WAYS(DEFINE_KERNEL, A1, POLICY, INCLUSIVE)
+FOR_L1_WAYS(DEFINE_KERNEL_ROW, LRU, 0)
+FOR_L1_WAYS(DEFINE_KERNEL_ROW, LRU, 1)
+FOR_L1_WAYS(DEFINE_KERNEL_ROW, FIFO, 0)
+FOR_L1_WAYS(DEFINE_KERNEL_ROW, FIFO, 1)
+
+#define KERNEL_ENTRY(A1, A2, POLICY, INCLUSIVE) KERNEL_NAME(A1, A2, POLICY, INCLUSIVE),
+#define KERNEL_ROW(A1, POLICY, INCLUSIVE) {FOR_L2_WAYS(KERNEL_ENTRY, A1, POLICY, INCLUSIVE)},
+
+#define L1_WAY_COUNTS 5
+#define L2_WAY_COUNTS 6
+
+// [policy - 1][inclusion][log2 L1 ways][L2 ways slot, 0 for none]
+static const SimKernel KERNELS[2][2][L1_WAY_COUNTS][L2_WAY_COUNTS] = {
+    {{FOR_L1_WAYS(KERNEL_ROW, LRU, 0)}, {FOR_L1_WAYS(KERNEL_ROW, LRU, 1)}},
+    {{FOR_L1_WAYS(KERNEL_ROW, FIFO, 0)}, {FOR_L1_WAYS(KERNEL_ROW, FIFO, 1)}},
+};
+
+// position of a way count in the table, -1 when it has no kernel
+static int waySlot(int ways, int maxSlot)
+{
+    if (ways <= 0 || !isPowerOfTwo(ways) || log2Int(ways) >= maxSlot)
+    {
+        return -1;
+    }
+    return log2Int(ways);
+}
+
+SimKernel selectKernel(const Simulator *sim)
+{
+#ifdef MISS_CLASSES
+    // the kernels carry no instrumentation hooks
+    return NULL;
+#endif
+    int policy = sim->config.replacementPolicy;
+    // set sampled runs decode through the engine's slot map, and prefetch
+    // fills, the victim cache, and the write-back buffer only exist in it
+    if ((policy != POLICY_LRU && policy != POLICY_FIFO) || sim->numSets[0] <= 0 || sim->groupOf != NULL ||
+        sim->prefetchers[0] != NULL || sim->prefetchers[1] != NULL || sim->victims != NULL ||
+        sim->writeBackBuffer != NULL)
+    {
+        return NULL;
+    }
+    int l1Slot = waySlot(sim->levels[0]->associativity, L1_WAY_COUNTS);
+    int l2Slot = 0;
+    if (sim->totalLevels > 1)
+    {
+        l2Slot = waySlot(sim->levels[1]->associativity, L2_WAY_COUNTS - 1);
+        l2Slot = l2Slot < 0 ? -1 : l2Slot + 1;
+    }
+    if (l1Slot < 0 || l2Slot < 0)
+    {
+        return NULL;
+    }
+    return KERNELS[policy - 1][sim->config.inclusionProperty == 1][l1Slot][l2Slot];
+}
+
+void simulateBatch(Simulator *sim, const unsigned char *operations,
+                   const unsigned long long *addresses, size_t n)
+{
+    SimKernel kernel = selectKernel(sim);
+    if (kernel != NULL)
+    {
+        kernel(sim, operations, addresses, n);
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        simulateAccess(sim, operations[i], addresses[i]);
+    }
+}
@@ -0,0 +1,23 @@
+// simulation kernels specialized at compile time for the associativities,
+// replacement policies, and inclusion properties that get swept
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+#include "cacheEngine.h"
+
+// runs n accesses in order, operations are 0 for read and 1 for write
+typedef void (*SimKernel)(Simulator *sim, const unsigned char *operations,
+                          const unsigned long long *addresses, size_t n);
+
+// the kernel built for sim's configuration, NULL when there is none and
+// the generic simulateAccess path has to be used
+SimKernel selectKernel(const Simulator *sim);
+
+// run a batch through the specialized kernel if there is one, otherwise
+// one simulateAccess per access
+void simulateBatch(Simulator *sim, const unsigned char *operations,
+                   const unsigned long long *addresses, size_t n);
+
+#endif
@@ -0,0 +1,34 @@
+// counting allocator hook, "make LEAK_DETECT=1" includes this after the
+// system headers of the engine so every allocation it makes is counted
+
+#ifndef LEAK_DETECTOR_C_H
+#define LEAK_DETECTOR_C_H
+
+#include <stdlib.h>
+
+// allocations made since the program started, defined in cacheEngine.c
+extern unsigned long long ALLOCATION_COUNT;
+
+static inline void *countedMalloc(size_t size)
+{
+    ALLOCATION_COUNT++;
+    return malloc(size);
+}
+
+static inline void *countedCalloc(size_t count, size_t size)
+{
+    ALLOCATION_COUNT++;
+    return calloc(count, size);
+}
+
+static inline void *countedRealloc(void *pointer, size_t size)
+{
+    ALLOCATION_COUNT++;
+    return realloc(pointer, size);
+}
+
+#define malloc(size) countedMalloc(size)
+#define calloc(count, size) countedCalloc(count, size)
+#define realloc(pointer, size) countedRealloc(pointer, size)
+
+#endif
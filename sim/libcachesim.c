@@ -0,0 +1,193 @@
+// the public handle API over the engine, a handle is a Simulator plus what
+// OPTIMAL needs from sim_plan
+#include <stdlib.h>
+#include "libcachesim.h"
+#include "cacheEngine.h"
+#include "kernels.h"
+
+// batches are handed to the kernels as they are, which only works while
+// the public element types are the engine's
+_Static_assert(sizeof(uint64_t) == sizeof(unsigned long long), "addresses are passed through uncopied");
+_Static_assert(sizeof(uint8_t) == sizeof(unsigned char), "operations are passed through uncopied");
+
+struct sim
+{
+    Simulator engine;
+    // OPTIMAL only, buildNextUse over the planned accesses
+    size_t *nextUse;
+    size_t planned;
+};
+
+static void toEngineConfig(const struct sim_config *config, SimConfig *engine)
+{
+    engine->blockSize = config->block_size;
+    engine->cacheSize[0] = config->l1_size;
+    engine->associativity[0] = config->l1_assoc;
+    engine->cacheSize[1] = config->l2_size;
+    engine->associativity[1] = config->l2_assoc;
+    engine->replacementPolicy = config->replacement_policy;
+    engine->inclusionProperty = config->inclusion;
+    engine->setSampling = 0;
+    for (int i = 0; i < MAX_LEVELS; i++)
+    {
+        engine->prefetcher[i] = PREFETCH_NONE;
+        engine->prefetchDegree[i] = 0;
+        engine->prefetchDistance[i] = 0;
+    }
+    engine->victimEntries = 0;
+    engine->writeBackEntries = 0;
+}
+
+int sim_check_config(const struct sim_config *config)
+{
+    if (config->block_size <= 0 || !isPowerOfTwo(config->block_size) || config->l1_size <= 0 ||
+        config->l1_assoc <= 0 || config->l2_size < 0 || config->l2_assoc < 0)
+    {
+        return SIM_ERR_CONFIG;
+    }
+    if (config->replacement_policy < SIM_POLICY_LRU || config->replacement_policy > SIM_POLICY_LFU ||
+        (config->inclusion != SIM_NON_INCLUSIVE && config->inclusion != SIM_INCLUSIVE))
+    {
+        return SIM_ERR_CONFIG;
+    }
+    // the same set counts createSimulator works out
+    int l1Sets = config->l1_size / (config->l1_assoc * config->block_size);
+    int l2Sets = config->l2_assoc == 0 ? 0 : config->l2_size / (config->l2_assoc * config->block_size);
+    if (l1Sets == 0 || !isPowerOfTwo(l1Sets))
+    {
+        return SIM_ERR_L1_SETS;
+    }
+    if (!isPowerOfTwo(l2Sets))
+    {
+        return SIM_ERR_L2_SETS;
+    }
+    if (config->replacement_policy == SIM_POLICY_PLRU &&
+        (!isPowerOfTwo(config->l1_assoc) || config->l1_assoc > 64 ||
+         (l2Sets > 0 && (!isPowerOfTwo(config->l2_assoc) || config->l2_assoc > 64))))
+    {
+        return SIM_ERR_CONFIG;
+    }
+    return SIM_OK;
+}
+
+struct sim *sim_create(const struct sim_config *config)
+{
+    if (sim_check_config(config) != SIM_OK)
+    {
+        return NULL;
+    }
+    struct sim *sim = calloc(1, sizeof(struct sim));
+    if (sim == NULL)
+    {
+        return NULL;
+    }
+    SimConfig engine;
+    toEngineConfig(config, &engine);
+    if (createSimulator(&sim->engine, &engine) != 0)
+    {
+        free(sim);
+        return NULL;
+    }
+    return sim;
+}
+
+void sim_destroy(struct sim *sim)
+{
+    if (sim == NULL)
+    {
+        return;
+    }
+    freeSimulator(&sim->engine);
+    free(sim->nextUse);
+    free(sim);
+}
+
+int sim_plan(struct sim *sim, const uint64_t *addrs, size_t n)
+{
+    if (sim->engine.position != 0)
+    {
+        return SIM_ERR_NO_PLAN;
+    }
+    size_t *nextUse = buildNextUse((const unsigned long long *)addrs, n, sim->engine.config.blockSize);
+    if (nextUse == NULL && n > 0)
+    {
+        return SIM_ERR_MEMORY;
+    }
+    free(sim->nextUse);
+    sim->nextUse = nextUse;
+    sim->planned = n;
+    sim->engine.nextUse = nextUse;
+    return SIM_OK;
+}
+
+int sim_access_batch(struct sim *sim, const uint64_t *addrs, const uint8_t *ops, size_t n)
+{
+    Simulator *engine = &sim->engine;
+    if (engine->config.replacementPolicy == POLICY_OPTIMAL &&
+        (sim->nextUse == NULL || n > sim->planned - engine->position))
+    {
+        return SIM_ERR_NO_PLAN;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (ops[i] != SIM_READ && ops[i] != SIM_WRITE)
+        {
+            return SIM_ERR_OPERATION;
+        }
+    }
+    simulateBatch(engine, ops, (const unsigned long long *)addrs, n);
+    return SIM_OK;
+}
+
+void sim_get_stats(const struct sim *sim, struct sim_stats *stats)
+{
+    // miss rates come from a copy so the handle stays untouched
+    Simulator engine = sim->engine;
+    finishSimulation(&engine);
+    const SimStats *counters = &engine.stats;
+
+    stats->accesses = engine.position;
+    stats->levels = engine.totalLevels;
+    for (int i = 0; i < MAX_LEVELS; i++)
+    {
+        struct sim_level_stats *level = &stats->level[i];
+        level->reads = counters->reads[i];
+        level->read_misses = counters->readMisses[i];
+        level->writes = counters->writes[i];
+        level->write_misses = counters->writeMisses[i];
+        level->write_backs = counters->writeBacks[i];
+        level->miss_rate = counters->missRate[i];
+    }
+    stats->memory_traffic = counters->memoryTraffic;
+}
+
+int sim_get_set(const struct sim *sim, int level, int set, uint64_t *tags)
+{
+    const Simulator *engine = &sim->engine;
+    if (level < 1 || level > engine->totalLevels || set < 0 || set >= engine->numSets[level - 1])
+    {
+        return -1;
+    }
+    const CacheLevel *cache = engine->levels[level - 1];
+    int base = set * cache->associativity;
+    unsigned short ranks[cache->associativity];
+    int count = 0;
+    // insertion sort on rank, sets are a handful of ways
+    for (int way = 0; way < cache->associativity; way++)
+    {
+        if (cache->tags[base + way] == INVALID_TAG)
+        {
+            continue;
+        }
+        int i = count++;
+        while (i > 0 && ranks[i - 1] > cache->rank[base + way])
+        {
+            ranks[i] = ranks[i - 1];
+            tags[i] = tags[i - 1];
+            i--;
+        }
+        ranks[i] = cache->rank[base + way];
+        tags[i] = cache->tags[base + way];
+    }
+    return count;
+}
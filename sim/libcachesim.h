@@ -0,0 +1,124 @@
+// libcachesim, the cache model as a library for programs that replay
+// accesses out of their own buffers instead of forking cacheSim and
+// reading its report. Build it with "make lib" and link libcachesim.a
+// (with -lz -lm -pthread) or libcachesim.so.
+//
+//   struct sim_config config = {16, 1024, 2, 8192, 4, SIM_POLICY_LRU, SIM_INCLUSIVE};
+//   struct sim *sim = sim_create(&config);
+//   sim_access_batch(sim, addresses, operations, n);
+//   struct sim_stats stats;
+//   sim_get_stats(sim, &stats);
+//   sim_destroy(sim);
+//
+// a handle is not thread safe, separate handles can run on separate threads
+
+#ifndef LIBCACHESIM_H
+#define LIBCACHESIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_POLICY_LRU 1
+#define SIM_POLICY_FIFO 2
+#define SIM_POLICY_OPTIMAL 3
+// tree pseudo-LRU, needs power of 2 associativities up to 64
+#define SIM_POLICY_PLRU 4
+#define SIM_POLICY_RANDOM 5
+// 2 bit re-reference interval prediction, static, bimodal, and set dueling
+#define SIM_POLICY_SRRIP 6
+#define SIM_POLICY_BRRIP 7
+#define SIM_POLICY_DRRIP 8
+// least frequently used with aging
+#define SIM_POLICY_LFU 9
+
+#define SIM_NON_INCLUSIVE 0
+#define SIM_INCLUSIVE 1
+
+// operations in a batch
+#define SIM_READ 0
+#define SIM_WRITE 1
+
+// returned by sim_check_config and sim_access_batch
+#define SIM_OK 0
+#define SIM_ERR_L1_SETS 1
+#define SIM_ERR_L2_SETS 2
+// a batch operation other than SIM_READ or SIM_WRITE
+#define SIM_ERR_OPERATION 3
+#define SIM_ERR_CONFIG 4
+// an OPTIMAL batch that runs past what sim_plan was given
+#define SIM_ERR_NO_PLAN 5
+#define SIM_ERR_MEMORY 6
+
+struct sim_config
+{
+    int block_size;
+    int l1_size;
+    int l1_assoc;
+    // an l2_size or l2_assoc of 0 simulates L1 alone
+    int l2_size;
+    int l2_assoc;
+    int replacement_policy;
+    int inclusion;
+};
+
+struct sim_level_stats
+{
+    uint64_t reads;
+    uint64_t read_misses;
+    uint64_t writes;
+    uint64_t write_misses;
+    uint64_t write_backs;
+    // misses over accesses for L1, read misses over reads for L2
+    double miss_rate;
+};
+
+struct sim_stats
+{
+    // accesses simulated so far, the sum of every batch
+    uint64_t accesses;
+    // 1 or 2, level[1] is all zero without an L2
+    int levels;
+    struct sim_level_stats level[2];
+    // blocks moved between the last level and memory
+    uint64_t memory_traffic;
+};
+
+struct sim;
+
+// SIM_OK when config describes a cache sim_create can build, otherwise the
+// first problem found
+int sim_check_config(const struct sim_config *config);
+
+// a simulator with every way empty, NULL when the config does not pass
+// sim_check_config or memory runs out
+struct sim *sim_create(const struct sim_config *config);
+void sim_destroy(struct sim *sim);
+
+// OPTIMAL only, called before the first batch with the addresses of every
+// access the batches will replay, in order, so replacement can look ahead.
+// Only the next use positions are kept, the buffer can be freed after.
+int sim_plan(struct sim *sim, const uint64_t *addrs, size_t n);
+
+// simulate n accesses in order, ops[i] is SIM_READ or SIM_WRITE. The
+// buffers are read in place, nothing is copied or decoded. A batch with any
+// other operation is rejected whole with SIM_ERR_OPERATION.
+int sim_access_batch(struct sim *sim, const uint64_t *addrs, const uint8_t *ops, size_t n);
+
+// counters as of the last batch, can be called between batches
+void sim_get_stats(const struct sim *sim, struct sim_stats *stats);
+
+// tags held by one set of level 1 or 2, most recently used (LRU, PLRU) or
+// filled (FIFO) first, a tag being the address shifted past the offset and index
+// bits. tags needs room for the level's associativity. Returns how many
+// ways hold a block, or -1 when the level or set does not exist.
+int sim_get_set(const struct sim *sim, int level, int set, uint64_t *tags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
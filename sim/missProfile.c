@@ -0,0 +1,247 @@
+// Hill's 3C model. A miss on a block never seen before is compulsory, a
+// miss a fully associative LRU cache of the same capacity would also take
+// is capacity, and any other miss is a conflict the set mapping caused.
+#include <stdlib.h>
+#include "missProfile.h"
+
+// block numbers per first touch chunk, one bit each
+#define CHUNK_BITS 9
+#define CHUNK_WORDS ((1 << CHUNK_BITS) / 64)
+#define EMPTY_CHUNK (~0ULL)
+
+static unsigned long long hashBlock(unsigned long long block)
+{
+    return block * 0x9e3779b97f4a7c15ULL;
+}
+
+MissProfile *createMissProfile(int numSets, int numBlocks)
+{
+    MissProfile *profile = calloc(1, sizeof(MissProfile));
+    profile->numSets = numSets;
+    profile->setAccesses = calloc(numSets, sizeof(long long));
+    profile->setMisses = calloc(numSets, sizeof(long long));
+    profile->setEvictions = calloc(numSets, sizeof(long long));
+
+    profile->touchCapacity = 64;
+    profile->touchChunks = malloc(profile->touchCapacity * sizeof(unsigned long long));
+    profile->touchBits = calloc(profile->touchCapacity * CHUNK_WORDS, sizeof(unsigned long long));
+    for (unsigned long long i = 0; i < profile->touchCapacity; i++)
+    {
+        profile->touchChunks[i] = EMPTY_CHUNK;
+    }
+
+    int buckets = 16;
+    while (buckets < numBlocks * 2)
+    {
+        buckets *= 2;
+    }
+    profile->shadowCapacity = numBlocks;
+    profile->shadowHead = -1;
+    profile->shadowTail = -1;
+    profile->shadowBlocks = malloc(numBlocks * sizeof(unsigned long long));
+    profile->shadowPrev = malloc(numBlocks * sizeof(int));
+    profile->shadowNext = malloc(numBlocks * sizeof(int));
+    profile->shadowChain = malloc(numBlocks * sizeof(int));
+    profile->shadowBuckets = malloc(buckets * sizeof(int));
+    profile->shadowBucketMask = buckets - 1;
+    for (int i = 0; i < buckets; i++)
+    {
+        profile->shadowBuckets[i] = -1;
+    }
+    return profile;
+}
+
+void freeMissProfile(MissProfile *profile)
+{
+    free(profile->setAccesses);
+    free(profile->setMisses);
+    free(profile->setEvictions);
+    free(profile->touchChunks);
+    free(profile->touchBits);
+    free(profile->shadowBlocks);
+    free(profile->shadowPrev);
+    free(profile->shadowNext);
+    free(profile->shadowChain);
+    free(profile->shadowBuckets);
+    free(profile);
+}
+
+// slot of a chunk in the first touch table, empty if it is not there yet
+static unsigned long long findChunk(const MissProfile *profile, unsigned long long chunk)
+{
+    unsigned long long mask = profile->touchCapacity - 1;
+    unsigned long long slot = hashBlock(chunk) & mask;
+    while (profile->touchChunks[slot] != EMPTY_CHUNK && profile->touchChunks[slot] != chunk)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// double the first touch table, keeping it at most half full
+static void growTouched(MissProfile *profile)
+{
+    unsigned long long oldCapacity = profile->touchCapacity;
+    unsigned long long *oldChunks = profile->touchChunks;
+    unsigned long long *oldBits = profile->touchBits;
+
+    profile->touchCapacity *= 2;
+    profile->touchChunks = malloc(profile->touchCapacity * sizeof(unsigned long long));
+    profile->touchBits = calloc(profile->touchCapacity * CHUNK_WORDS, sizeof(unsigned long long));
+    for (unsigned long long i = 0; i < profile->touchCapacity; i++)
+    {
+        profile->touchChunks[i] = EMPTY_CHUNK;
+    }
+    for (unsigned long long i = 0; i < oldCapacity; i++)
+    {
+        if (oldChunks[i] == EMPTY_CHUNK)
+        {
+            continue;
+        }
+        unsigned long long slot = findChunk(profile, oldChunks[i]);
+        profile->touchChunks[slot] = oldChunks[i];
+        for (int word = 0; word < CHUNK_WORDS; word++)
+        {
+            profile->touchBits[slot * CHUNK_WORDS + word] = oldBits[i * CHUNK_WORDS + word];
+        }
+    }
+    free(oldChunks);
+    free(oldBits);
+}
+
+// mark a block touched, returns whether it had been touched before
+static int touchBlock(MissProfile *profile, unsigned long long block)
+{
+    unsigned long long chunk = block >> CHUNK_BITS;
+    unsigned long long slot = findChunk(profile, chunk);
+    if (profile->touchChunks[slot] == EMPTY_CHUNK)
+    {
+        if ((profile->touchCount + 1) * 2 > profile->touchCapacity)
+        {
+            growTouched(profile);
+            slot = findChunk(profile, chunk);
+        }
+        profile->touchChunks[slot] = chunk;
+        profile->touchCount++;
+    }
+    int bit = block & ((1 << CHUNK_BITS) - 1);
+    unsigned long long *word = &profile->touchBits[slot * CHUNK_WORDS + bit / 64];
+    unsigned long long mask = 1ULL << (bit % 64);
+    int touched = (*word & mask) != 0;
+    *word |= mask;
+    return touched;
+}
+
+static void shadowUnlink(MissProfile *profile, int node)
+{
+    int prev = profile->shadowPrev[node];
+    int next = profile->shadowNext[node];
+    if (prev >= 0)
+    {
+        profile->shadowNext[prev] = next;
+    }
+    else
+    {
+        profile->shadowHead = next;
+    }
+    if (next >= 0)
+    {
+        profile->shadowPrev[next] = prev;
+    }
+    else
+    {
+        profile->shadowTail = prev;
+    }
+}
+
+static void shadowPushFront(MissProfile *profile, int node)
+{
+    profile->shadowPrev[node] = -1;
+    profile->shadowNext[node] = profile->shadowHead;
+    if (profile->shadowHead >= 0)
+    {
+        profile->shadowPrev[profile->shadowHead] = node;
+    }
+    profile->shadowHead = node;
+    if (profile->shadowTail < 0)
+    {
+        profile->shadowTail = node;
+    }
+}
+
+// take a node's block out of its hash chain
+static void shadowForget(MissProfile *profile, int node)
+{
+    int *link = &profile->shadowBuckets[hashBlock(profile->shadowBlocks[node]) & profile->shadowBucketMask];
+    while (*link != node)
+    {
+        link = &profile->shadowChain[*link];
+    }
+    *link = profile->shadowChain[node];
+}
+
+// access the shadow cache, returns whether it hit, misses fill it and
+// replace its least recently used block once it is full
+static int shadowAccess(MissProfile *profile, unsigned long long block)
+{
+    int bucket = hashBlock(block) & profile->shadowBucketMask;
+    for (int node = profile->shadowBuckets[bucket]; node >= 0; node = profile->shadowChain[node])
+    {
+        if (profile->shadowBlocks[node] == block)
+        {
+            shadowUnlink(profile, node);
+            shadowPushFront(profile, node);
+            return 1;
+        }
+    }
+    if (profile->shadowCapacity == 0)
+    {
+        return 0;
+    }
+
+    int node;
+    if (profile->shadowCount < profile->shadowCapacity)
+    {
+        node = profile->shadowCount++;
+    }
+    else
+    {
+        node = profile->shadowTail;
+        shadowUnlink(profile, node);
+        shadowForget(profile, node);
+    }
+    profile->shadowBlocks[node] = block;
+    profile->shadowChain[node] = profile->shadowBuckets[bucket];
+    profile->shadowBuckets[bucket] = node;
+    shadowPushFront(profile, node);
+    return 0;
+}
+
+void profileAccess(MissProfile *profile, unsigned long long block, int set, int hit)
+{
+    int touched = touchBlock(profile, block);
+    int shadowHit = shadowAccess(profile, block);
+    profile->setAccesses[set]++;
+    if (hit)
+    {
+        return;
+    }
+    profile->setMisses[set]++;
+    if (!touched)
+    {
+        profile->compulsory++;
+    }
+    else if (!shadowHit)
+    {
+        profile->capacity++;
+    }
+    else
+    {
+        profile->conflict++;
+    }
+}
+
+void profileEviction(MissProfile *profile, int set)
+{
+    profile->setEvictions[set]++;
+}
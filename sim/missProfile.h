@@ -0,0 +1,50 @@
+// 3C miss classification and per-set counters for one cache level, only
+// built into the engine with "make MISS_CLASSES=1"
+
+#ifndef MISS_PROFILE_H
+#define MISS_PROFILE_H
+
+typedef struct MissProfile
+{
+    // every miss of the level is exactly one of these
+    long long compulsory;
+    long long capacity;
+    long long conflict;
+
+    // per set counters, indexed by set
+    int numSets;
+    long long *setAccesses;
+    long long *setMisses;
+    long long *setEvictions;
+
+    // first touch bitmap over block numbers, kept sparse as an open
+    // addressing table of 512 block chunks with 8 words of bits each
+    unsigned long long *touchChunks;
+    unsigned long long *touchBits;
+    unsigned long long touchCapacity;
+    unsigned long long touchCount;
+
+    // shadow fully associative LRU holding as many blocks as the level,
+    // a doubly linked recency list with a chained hash table over it
+    int shadowCapacity;
+    int shadowCount;
+    int shadowHead;
+    int shadowTail;
+    unsigned long long *shadowBlocks;
+    int *shadowPrev;
+    int *shadowNext;
+    int *shadowChain;
+    int *shadowBuckets;
+    int shadowBucketMask;
+} MissProfile;
+
+MissProfile *createMissProfile(int numSets, int numBlocks);
+void freeMissProfile(MissProfile *profile);
+
+// record one access to the level, hit is whether the real cache had the
+// block, and classify it when it did not
+void profileAccess(MissProfile *profile, unsigned long long block, int set, int hit);
+// record a block replaced out of set
+void profileEviction(MissProfile *profile, int set);
+
+#endif
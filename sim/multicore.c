@@ -0,0 +1,849 @@
+// --multicore mode, private MESI L1s over one shared L2
+//
+// A core's thread only runs ahead through private hits, reads of a block
+// its L1 holds and writes of an E or M copy, which change nothing but its
+// own L1. It publishes in ahead where its run of known private hits ends
+// and applies a hit only while the hit comes before every other core's
+// ahead in the global order. Any other access is an event. An event runs
+// once every core has applied all accesses before it, and only one can be
+// that early. Events change other L1s under their lock and pull those
+// cores' ahead back, so runs scanned against the old state are classified
+// again.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "cacheSim.h"
+#include "traceReader.h"
+#include "multicore.h"
+#include "policy.h"
+
+// state of every L1 way, ways without a block are MESI_INVALID
+#define MESI_INVALID 0
+#define MESI_SHARED 1
+#define MESI_EXCLUSIVE 2
+#define MESI_MODIFIED 3
+
+// private hits a core classifies past the next access it applies
+#define CORE_LOOKAHEAD 256
+
+// open addressing map from block number to the mask of the L1s holding it,
+// blocks no L1 holds have no entry, INVALID_TAG marks a free slot
+typedef struct Directory
+{
+    unsigned long long *blocks;
+    unsigned long long *sharers;
+    int bits;
+    size_t mask;
+} Directory;
+
+typedef struct Core
+{
+    struct Multicore *system;
+    int id;
+    const char *traceName;
+    TraceBuffer trace;
+    CacheLevel *l1;
+    unsigned char *state;
+    // L1 counters at level 0 and the core's requests to the shared L2 at
+    // level 1, cacheToCacheTransfers[0] counts misses another L1 served
+    SimStats stats;
+    long long upgrades;
+    // copies other cores' writes invalidated and copies the inclusive L2
+    // took back
+    long long invalidated;
+    long long backInvalidated;
+    // L2 blocks this core brought in that another core's miss evicted
+    long long evictedByOthers;
+    // trace position of the next access to apply, and the end of the run of
+    // private hits known to follow it
+    atomic_size_t next;
+    atomic_size_t ahead;
+    // held while the core scans or changes its L1 and by events changing it
+    pthread_mutex_t lock;
+} Core;
+
+typedef struct Multicore
+{
+    SimConfig config;
+    int cores;
+    Core *core;
+    CacheLevel *l2;
+    // per L2 way the core whose request filled it
+    unsigned char *filledBy;
+    Directory directory;
+    // L2 write-backs and memory traffic of every core
+    SimStats stats;
+    long long backInvalidations;
+    long long l2Evictions;
+    long long crossEvictions;
+    // bumped when an event starts and when it ends, odd while one runs
+    atomic_ulong events;
+} Multicore;
+
+static size_t directoryHome(const Directory *directory, unsigned long long block)
+{
+    return (size_t)((block * 0x9e3779b97f4a7c15ULL) >> (64 - directory->bits));
+}
+
+static size_t directorySlot(const Directory *directory, unsigned long long block)
+{
+    size_t slot = directoryHome(directory, block);
+    while (directory->blocks[slot] != INVALID_TAG && directory->blocks[slot] != block)
+    {
+        slot = (slot + 1) & directory->mask;
+    }
+    return slot;
+}
+
+static unsigned long long directorySharers(const Directory *directory, unsigned long long block)
+{
+    size_t slot = directorySlot(directory, block);
+    return directory->blocks[slot] == block ? directory->sharers[slot] : 0;
+}
+
+// an empty mask removes the block's entry, the entries probed past it are
+// shifted back so no lookup stops early at the hole
+static void directoryUpdate(Directory *directory, unsigned long long block, unsigned long long sharers)
+{
+    size_t slot = directorySlot(directory, block);
+    if (sharers != 0)
+    {
+        directory->blocks[slot] = block;
+        directory->sharers[slot] = sharers;
+        return;
+    }
+    if (directory->blocks[slot] != block)
+    {
+        return;
+    }
+    size_t hole = slot;
+    for (size_t i = (slot + 1) & directory->mask; directory->blocks[i] != INVALID_TAG; i = (i + 1) & directory->mask)
+    {
+        size_t home = directoryHome(directory, directory->blocks[i]);
+        if (((i - home) & directory->mask) >= ((i - hole) & directory->mask))
+        {
+            directory->blocks[hole] = directory->blocks[i];
+            directory->sharers[hole] = directory->sharers[i];
+            hole = i;
+        }
+    }
+    directory->blocks[hole] = INVALID_TAG;
+}
+
+// position in the round-robin interleaving, finished cores sort last
+static size_t globalOrder(const Core *core, size_t position)
+{
+    return position >= core->trace.length ? SIZE_MAX : position * core->system->cores + core->id;
+}
+
+// way holding address or -1, with the set in block->index
+static int findAddress(CacheLevel *cache, unsigned long long address, Block *block)
+{
+    block->index = (int)((address >> cache->offsetBits) & cache->indexMask);
+    block->tag = address >> cache->tagShift;
+    return findWay(cache, block);
+}
+
+static void touchWay(CacheLevel *cache, int set, int way)
+{
+    if (cache->policy->onHit != NULL)
+    {
+        cache->policy->onHit(cache, set, way);
+    }
+}
+
+static void placeWay(CacheLevel *cache, int set, int way)
+{
+    promoteWay(cache, set, way);
+    if (cache->policy->onFill != NULL)
+    {
+        cache->policy->onFill(cache, set, way);
+    }
+}
+
+static int isPrivateHit(Core *core, size_t position)
+{
+    Block block;
+    int way = findAddress(core->l1, core->trace.addresses[position], &block);
+    return way >= 0 && (core->trace.operations[position] == 0 ||
+                        core->state[block.index * core->l1->associativity + way] != MESI_SHARED);
+}
+
+static void applyHit(Core *core, size_t position)
+{
+    Block block;
+    int way = findAddress(core->l1, core->trace.addresses[position], &block);
+    int slot = block.index * core->l1->associativity + way;
+    if (core->trace.operations[position] == 0)
+    {
+        core->stats.reads[0] += 1;
+    }
+    else
+    {
+        // E to M needs no one else
+        core->stats.writes[0] += 1;
+        core->state[slot] = MESI_MODIFIED;
+        core->l1->dirty[slot] = 1;
+    }
+    touchWay(core->l1, block.index, way);
+}
+
+// move holder's copy of block to state and return the state it had, only
+// ever a downgrade or an invalidation
+static int setCopy(Core *requester, Core *holder, unsigned long long block, int state)
+{
+    CacheLevel *l1 = holder->l1;
+    Block decoded;
+    int old = MESI_INVALID;
+    if (holder != requester)
+    {
+        pthread_mutex_lock(&holder->lock);
+    }
+    int way = findAddress(l1, block << l1->offsetBits, &decoded);
+    if (way >= 0)
+    {
+        int slot = decoded.index * l1->associativity + way;
+        old = holder->state[slot];
+        holder->state[slot] = state;
+        l1->dirty[slot] = 0;
+        if (state == MESI_INVALID)
+        {
+            l1->tags[slot] = INVALID_TAG;
+        }
+    }
+    // the holder scans its run again against the new state
+    atomic_store(&holder->ahead, atomic_load(&holder->next));
+    if (holder != requester)
+    {
+        pthread_mutex_unlock(&holder->lock);
+    }
+    return old;
+}
+
+static int copyState(Core *requester, Core *holder, unsigned long long block)
+{
+    CacheLevel *l1 = holder->l1;
+    Block decoded;
+    if (holder != requester)
+    {
+        pthread_mutex_lock(&holder->lock);
+    }
+    int way = findAddress(l1, block << l1->offsetBits, &decoded);
+    int state = way < 0 ? MESI_INVALID : holder->state[decoded.index * l1->associativity + way];
+    if (holder != requester)
+    {
+        pthread_mutex_unlock(&holder->lock);
+    }
+    return state;
+}
+
+static void invalidateSharers(Multicore *system, Core *requester, unsigned long long block, unsigned long long sharers)
+{
+    for (int c = 0; c < system->cores; c++)
+    {
+        if ((sharers >> c) & 1)
+        {
+            setCopy(requester, &system->core[c], block, MESI_INVALID);
+            system->core[c].invalidated += 1;
+        }
+    }
+}
+
+static void evictL2(Multicore *system, Core *requester, int set, int way)
+{
+    CacheLevel *l2 = system->l2;
+    int slot = set * l2->associativity + way;
+    unsigned long long block = wayAddress(l2, set, way) >> l2->offsetBits;
+
+    system->l2Evictions += 1;
+    if (system->filledBy[slot] != requester->id)
+    {
+        system->crossEvictions += 1;
+        system->core[system->filledBy[slot]].evictedByOthers += 1;
+    }
+    if (l2->dirty[slot] == 1)
+    {
+        system->stats.writeBacks[1] += 1;
+        system->stats.memoryTraffic += 1;
+    }
+    l2->tags[slot] = INVALID_TAG;
+    l2->dirty[slot] = 0;
+
+    // an inclusive L2 takes its victims out of every L1, dirty copies go
+    // straight to memory
+    if (system->config.inclusionProperty == 1)
+    {
+        unsigned long long sharers = directorySharers(&system->directory, block);
+        for (int c = 0; c < system->cores; c++)
+        {
+            if ((sharers >> c) & 1)
+            {
+                if (setCopy(requester, &system->core[c], block, MESI_INVALID) == MESI_MODIFIED)
+                {
+                    system->stats.memoryTraffic += 1;
+                }
+                system->core[c].backInvalidated += 1;
+                system->backInvalidations += 1;
+            }
+        }
+        directoryUpdate(&system->directory, block, 0);
+    }
+}
+
+// one read (0) or write (1) request to the shared L2, counted for the
+// requesting core, misses are filled from memory
+static void accessL2(Multicore *system, Core *requester, int operation, unsigned long long address)
+{
+    CacheLevel *l2 = system->l2;
+    SimStats *stats = &requester->stats;
+    Block block;
+    int way = findAddress(l2, address, &block);
+
+    if (operation == 0)
+    {
+        stats->reads[1] += 1;
+    }
+    else
+    {
+        stats->writes[1] += 1;
+    }
+    if (way >= 0)
+    {
+        touchWay(l2, block.index, way);
+    }
+    else
+    {
+        if (operation == 0)
+        {
+            stats->readMisses[1] += 1;
+        }
+        else
+        {
+            stats->writeMisses[1] += 1;
+        }
+        way = selectVictim(l2, block.index);
+        if (l2->tags[block.index * l2->associativity + way] != INVALID_TAG)
+        {
+            evictL2(system, requester, block.index, way);
+        }
+        system->stats.memoryTraffic += 1;
+        l2->tags[block.index * l2->associativity + way] = block.tag;
+        system->filledBy[block.index * l2->associativity + way] = requester->id;
+        placeWay(l2, block.index, way);
+    }
+    if (operation == 1)
+    {
+        l2->dirty[block.index * l2->associativity + way] = 1;
+    }
+}
+
+static void evictL1(Multicore *system, Core *core, int set, int way)
+{
+    CacheLevel *l1 = core->l1;
+    int slot = set * l1->associativity + way;
+    unsigned long long address = wayAddress(l1, set, way);
+    unsigned long long block = address >> l1->offsetBits;
+    int state = core->state[slot];
+
+    core->state[slot] = MESI_INVALID;
+    l1->tags[slot] = INVALID_TAG;
+    l1->dirty[slot] = 0;
+    directoryUpdate(&system->directory, block, directorySharers(&system->directory, block) & ~(1ULL << core->id));
+    if (state == MESI_MODIFIED)
+    {
+        core->stats.writeBacks[0] += 1;
+        accessL2(system, core, 1, address);
+    }
+}
+
+// one access in the global order, a private hit is only applied
+static void runAccess(Multicore *system, Core *core, size_t position)
+{
+    CacheLevel *l1 = core->l1;
+    Directory *directory = &system->directory;
+    int operation = core->trace.operations[position];
+    unsigned long long address = core->trace.addresses[position];
+    unsigned long long block = address >> l1->offsetBits;
+    unsigned long long self = 1ULL << core->id;
+    Block decoded;
+    int way = findAddress(l1, address, &decoded);
+
+    if (way >= 0 && (operation == 0 || core->state[decoded.index * l1->associativity + way] != MESI_SHARED))
+    {
+        applyHit(core, position);
+        return;
+    }
+    if (operation == 0)
+    {
+        core->stats.reads[0] += 1;
+    }
+    else
+    {
+        core->stats.writes[0] += 1;
+    }
+
+    // a write to a shared copy, the other sharers are invalidated
+    if (way >= 0)
+    {
+        int slot = decoded.index * l1->associativity + way;
+        core->upgrades += 1;
+        invalidateSharers(system, core, block, directorySharers(directory, block) & ~self);
+        directoryUpdate(directory, block, self);
+        core->state[slot] = MESI_MODIFIED;
+        l1->dirty[slot] = 1;
+        touchWay(l1, decoded.index, way);
+        return;
+    }
+
+    if (operation == 0)
+    {
+        core->stats.readMisses[0] += 1;
+    }
+    else
+    {
+        core->stats.writeMisses[0] += 1;
+    }
+    way = selectVictim(l1, decoded.index);
+    if (l1->tags[decoded.index * l1->associativity + way] != INVALID_TAG)
+    {
+        evictL1(system, core, decoded.index, way);
+    }
+
+    // an E or M copy in another L1 supplies the block
+    unsigned long long sharers = directorySharers(directory, block);
+    Core *owner = NULL;
+    int ownerState = MESI_INVALID;
+    for (int c = 0; c < system->cores && owner == NULL; c++)
+    {
+        if ((sharers >> c) & 1)
+        {
+            int state = copyState(core, &system->core[c], block);
+            if (state == MESI_EXCLUSIVE || state == MESI_MODIFIED)
+            {
+                owner = &system->core[c];
+                ownerState = state;
+            }
+        }
+    }
+    if (owner != NULL)
+    {
+        core->stats.cacheToCacheTransfers[0] += 1;
+    }
+
+    int state;
+    if (operation == 0)
+    {
+        if (owner == NULL)
+        {
+            accessL2(system, core, 0, address);
+        }
+        else
+        {
+            // the owner keeps a shared copy, a modified one is written back
+            // to L2 on the way
+            setCopy(core, owner, block, MESI_SHARED);
+            if (ownerState == MESI_MODIFIED)
+            {
+                accessL2(system, core, 1, address);
+            }
+        }
+        sharers = directorySharers(directory, block);
+        state = sharers != 0 ? MESI_SHARED : MESI_EXCLUSIVE;
+    }
+    else
+    {
+        // a modified block moves to the writer without going through L2
+        if (owner == NULL)
+        {
+            accessL2(system, core, 0, address);
+        }
+        sharers = directorySharers(directory, block);
+        invalidateSharers(system, core, block, sharers);
+        sharers = 0;
+        state = MESI_MODIFIED;
+    }
+    directoryUpdate(directory, block, sharers | self);
+
+    int slot = decoded.index * l1->associativity + way;
+    l1->tags[slot] = decoded.tag;
+    l1->dirty[slot] = state == MESI_MODIFIED;
+    core->state[slot] = state;
+    placeWay(l1, decoded.index, way);
+}
+
+// the earliest global position another core may still have an event at,
+// read between events so no ahead is caught half way through a pull back
+static size_t safeHorizon(Core *core)
+{
+    Multicore *system = core->system;
+    unsigned long before = atomic_load(&system->events);
+    if (before & 1)
+    {
+        return 0;
+    }
+    size_t horizon = SIZE_MAX;
+    for (int c = 0; c < system->cores; c++)
+    {
+        Core *other = &system->core[c];
+        if (other == core)
+        {
+            continue;
+        }
+        size_t order = globalOrder(other, atomic_load(&other->ahead));
+        if (order < horizon)
+        {
+            horizon = order;
+        }
+    }
+    return atomic_load(&system->events) == before ? horizon : 0;
+}
+
+// every core has applied all of its accesses before position
+static int eventReady(Core *core, size_t position)
+{
+    Multicore *system = core->system;
+    size_t order = globalOrder(core, position);
+    for (int c = 0; c < system->cores; c++)
+    {
+        Core *other = &system->core[c];
+        if (other != core && globalOrder(other, atomic_load(&other->next)) < order)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// scan ahead, apply the hits that are safe, and run the core's event when
+// it is the earliest one left, returns whether anything moved
+static int stepCore(Core *core)
+{
+    Multicore *system = core->system;
+    size_t length = core->trace.length;
+    size_t next = atomic_load(&core->next);
+    int progress = 0;
+
+    pthread_mutex_lock(&core->lock);
+    size_t ahead = atomic_load(&core->ahead);
+    size_t limit = length - next > CORE_LOOKAHEAD ? next + CORE_LOOKAHEAD : length;
+    size_t scanned = ahead;
+    while (scanned < limit && isPrivateHit(core, scanned))
+    {
+        scanned++;
+    }
+    if (scanned > ahead)
+    {
+        atomic_store(&core->ahead, scanned);
+        progress = 1;
+    }
+    size_t horizon = safeHorizon(core);
+    size_t applied = next;
+    while (applied < scanned && globalOrder(core, applied) < horizon)
+    {
+        applyHit(core, applied++);
+    }
+    if (applied > next)
+    {
+        atomic_store(&core->next, applied);
+        next = applied;
+        progress = 1;
+    }
+    pthread_mutex_unlock(&core->lock);
+
+    if (next < length && atomic_load(&core->ahead) == next && eventReady(core, next))
+    {
+        atomic_fetch_add(&system->events, 1);
+        runAccess(system, core, next);
+        atomic_store(&core->ahead, next + 1);
+        atomic_store(&core->next, next + 1);
+        atomic_fetch_add(&system->events, 1);
+        progress = 1;
+    }
+    return progress;
+}
+
+static void *coreWorker(void *arg)
+{
+    Core *core = arg;
+    while (atomic_load(&core->next) < core->trace.length)
+    {
+        if (!stepCore(core))
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void runSerial(Multicore *system)
+{
+    for (size_t position = 0;; position++)
+    {
+        int active = 0;
+        for (int c = 0; c < system->cores; c++)
+        {
+            Core *core = &system->core[c];
+            if (position < core->trace.length)
+            {
+                runAccess(system, core, position);
+                active = 1;
+            }
+        }
+        if (!active)
+        {
+            break;
+        }
+    }
+}
+
+static void runThreaded(Multicore *system)
+{
+    pthread_t *workers = malloc(system->cores * sizeof(pthread_t));
+    int started = 0;
+    while (started < system->cores && pthread_create(&workers[started], NULL, coreWorker, &system->core[started]) == 0)
+    {
+        started++;
+    }
+    // cores that did not get a thread are stepped here in turn
+    for (;;)
+    {
+        int pending = 0;
+        int progress = 0;
+        for (int c = started; c < system->cores; c++)
+        {
+            Core *core = &system->core[c];
+            if (atomic_load(&core->next) < core->trace.length)
+            {
+                pending = 1;
+                progress |= stepCore(core);
+            }
+        }
+        if (!pending)
+        {
+            break;
+        }
+        if (!progress)
+        {
+            sched_yield();
+        }
+    }
+    for (int c = 0; c < started; c++)
+    {
+        pthread_join(workers[c], NULL);
+    }
+    free(workers);
+}
+
+static double missRate(long long misses, long long accesses)
+{
+    return accesses == 0 ? 0 : (double)misses / accesses;
+}
+
+static void printMulticore(Multicore *system)
+{
+    SimConfig *config = &system->config;
+    printf("===== Multi-core configuration =====\n");
+    printf("CORES:\t\t\t%d\n", system->cores);
+    printf("BLOCKSIZE:\t\t%d\n", config->blockSize);
+    printf("L1_SIZE:\t\t%d per core\n", config->cacheSize[0]);
+    printf("L1_ASSOC:\t\t%d\n", config->associativity[0]);
+    printf("L2_SIZE:\t\t%d shared\n", config->cacheSize[1]);
+    printf("L2_ASSOC:\t\t%d\n", config->associativity[1]);
+    printf("REPLACEMENT POLICY:\t%s\n", policyName(config->replacementPolicy));
+    printf("INCLUSION PROPERTY:\t%s\n", config->inclusionProperty == 0 ? "non-inclusive" : "inclusive");
+    printf("COHERENCE:\t\tMESI directory\n");
+
+    SimStats shared;
+    memset(&shared, 0, sizeof(shared));
+    long long invalidations = 0;
+    long long upgrades = 0;
+    long long transfers = 0;
+    for (int c = 0; c < system->cores; c++)
+    {
+        Core *core = &system->core[c];
+        SimStats *stats = &core->stats;
+        printf("===== Core %d (%s) =====\n", c, core->traceName);
+        printf("a. number of L1 reads:        %lld\n", stats->reads[0]);
+        printf("b. number of L1 read misses:  %lld\n", stats->readMisses[0]);
+        printf("c. number of L1 writes:       %lld\n", stats->writes[0]);
+        printf("d. number of L1 write misses: %lld\n", stats->writeMisses[0]);
+        printf("e. L1 miss rate:              %f\n", missRate(stats->readMisses[0] + stats->writeMisses[0], stats->reads[0] + stats->writes[0]));
+        printf("f. number of L1 writebacks:   %lld\n", stats->writeBacks[0]);
+        printf("g. number of L2 reads:        %lld\n", stats->reads[1]);
+        printf("h. number of L2 read misses:  %lld\n", stats->readMisses[1]);
+        printf("i. number of L2 writes:       %lld\n", stats->writes[1]);
+        printf("j. number of L2 write misses: %lld\n", stats->writeMisses[1]);
+        printf("upgrades from S to M:         %lld\n", core->upgrades);
+        printf("invalidated by other cores:   %lld\n", core->invalidated);
+        printf("misses another L1 served:     %lld\n", stats->cacheToCacheTransfers[0]);
+        printf("back-invalidated by L2:       %lld\n", core->backInvalidated);
+        printf("L2 blocks others evicted:     %lld\n", core->evictedByOthers);
+        shared.reads[1] += stats->reads[1];
+        shared.readMisses[1] += stats->readMisses[1];
+        shared.writes[1] += stats->writes[1];
+        shared.writeMisses[1] += stats->writeMisses[1];
+        invalidations += core->invalidated;
+        upgrades += core->upgrades;
+        transfers += stats->cacheToCacheTransfers[0];
+    }
+    printf("===== Shared L2 =====\n");
+    printf("g. number of L2 reads:        %lld\n", shared.reads[1]);
+    printf("h. number of L2 read misses:  %lld\n", shared.readMisses[1]);
+    printf("i. number of L2 writes:       %lld\n", shared.writes[1]);
+    printf("j. number of L2 write misses: %lld\n", shared.writeMisses[1]);
+    printf("k. L2 miss rate:              %f\n", missRate(shared.readMisses[1], shared.reads[1]));
+    printf("l. number of L2 writebacks:   %lld\n", system->stats.writeBacks[1]);
+    printf("m. total memory traffic:      %lld\n", system->stats.memoryTraffic);
+    printf("===== Coherence =====\n");
+    printf("invalidations:                %lld\n", invalidations);
+    printf("upgrades:                     %lld\n", upgrades);
+    printf("cache-to-cache transfers:     %lld\n", transfers);
+    printf("back-invalidations:           %lld\n", system->backInvalidations);
+    printf("cross-core L2 evictions:      %lld of %lld\n", system->crossEvictions, system->l2Evictions);
+}
+
+static void freeMulticore(Multicore *system)
+{
+    for (int c = 0; c < system->cores; c++)
+    {
+        Core *core = &system->core[c];
+        freeTraceBuffer(&core->trace);
+        if (core->l1 != NULL)
+        {
+            freeCacheLevel(core->l1);
+            pthread_mutex_destroy(&core->lock);
+        }
+        free(core->state);
+    }
+    if (system->l2 != NULL)
+    {
+        freeCacheLevel(system->l2);
+    }
+    free(system->filledBy);
+    free(system->directory.blocks);
+    free(system->directory.sharers);
+    free(system->core);
+}
+
+int runMulticore(char *args[], char *traceList, int threads)
+{
+    SimConfig config;
+    memset(&config, 0, sizeof(config));
+    if (checkBlock(args[0], &config) != 0 ||
+        checkCacheSize(args[1], 1, &config) != 0 ||
+        checkCacheAssoc(args[2], 1, &config) != 0 ||
+        checkCacheSize(args[3], 2, &config) != 0 ||
+        checkCacheAssoc(args[4], 2, &config) != 0 ||
+        checkReplacementPolicy(args[5], &config) != 0 ||
+        checkInclusionProperty(args[6], &config) != 0)
+    {
+        return 1;
+    }
+    if (config.replacementPolicy == POLICY_OPTIMAL)
+    {
+        printf(">>> --multicore cannot replay OPTIMAL, it needs one future per core\n");
+        return 1;
+    }
+    int numSets[MAX_LEVELS];
+    for (int i = 0; i < MAX_LEVELS; i++)
+    {
+        numSets[i] = config.associativity[i] <= 0 ? 0 : config.cacheSize[i] / (config.associativity[i] * config.blockSize);
+        if (numSets[i] == 0)
+        {
+            printf(">>> --multicore needs a private L1 and a shared L2\n");
+            return 1;
+        }
+        if (!isPowerOfTwo(numSets[i]))
+        {
+            printf("L%d sets is not a power of 2, please re check values\n", i + 1);
+            return 1;
+        }
+        if (config.replacementPolicy == POLICY_PLRU && (!isPowerOfTwo(config.associativity[i]) || config.associativity[i] > 64))
+        {
+            printf(">>> PLRU needs a power of 2 associativity of at most 64 at every level\n");
+            return 1;
+        }
+    }
+
+    char *traces[MAX_CORES];
+    int cores = 0;
+    for (char *name = strtok(traceList, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        if (cores == MAX_CORES)
+        {
+            cores++;
+            break;
+        }
+        traces[cores++] = name;
+    }
+    if (cores == 0 || cores > MAX_CORES)
+    {
+        printf(">>> --multicore takes 1 to %d comma separated traces, one per core\n", MAX_CORES);
+        return 1;
+    }
+
+    Multicore system;
+    memset(&system, 0, sizeof(system));
+    system.config = config;
+    system.cores = cores;
+    system.core = calloc(cores, sizeof(Core));
+    for (int c = 0; c < cores; c++)
+    {
+        Core *core = &system.core[c];
+        core->system = &system;
+        core->id = c;
+        core->traceName = traces[c];
+        if (loadTrace(traces[c], &core->trace) != 0)
+        {
+            printf("Could not open file.\n");
+            freeMulticore(&system);
+            return 1;
+        }
+        core->l1 = createCacheLevel(1, config.cacheSize[0], config.associativity[0], numSets[0], config.blockSize, config.replacementPolicy, NULL);
+        core->state = calloc(numSets[0] * config.associativity[0], sizeof(unsigned char));
+        atomic_init(&core->next, 0);
+        atomic_init(&core->ahead, 0);
+        pthread_mutex_init(&core->lock, NULL);
+    }
+    system.l2 = createCacheLevel(2, config.cacheSize[1], config.associativity[1], numSets[1], config.blockSize, config.replacementPolicy, NULL);
+    system.filledBy = calloc(numSets[1] * config.associativity[1], sizeof(unsigned char));
+
+    // at most one entry per L1 block, kept under half full
+    size_t l1Blocks = (size_t)cores * numSets[0] * config.associativity[0];
+    Directory *directory = &system.directory;
+    directory->bits = 4;
+    while (((size_t)1 << directory->bits) < 2 * l1Blocks)
+    {
+        directory->bits++;
+    }
+    directory->mask = ((size_t)1 << directory->bits) - 1;
+    directory->blocks = malloc((directory->mask + 1) * sizeof(unsigned long long));
+    directory->sharers = malloc((directory->mask + 1) * sizeof(unsigned long long));
+    for (size_t i = 0; i <= directory->mask; i++)
+    {
+        directory->blocks[i] = INVALID_TAG;
+    }
+    atomic_init(&system.events, 0);
+
+    // spinning cores only pay off with a CPU each
+    if (threads <= 0)
+    {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < cores || cores == 1)
+    {
+        runSerial(&system);
+    }
+    else
+    {
+        runThreaded(&system);
+    }
+    printMulticore(&system);
+    freeMulticore(&system);
+    return 0;
+}
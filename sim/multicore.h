@@ -0,0 +1,20 @@
+// --multicore mode, private L1s kept coherent by a MESI directory over one
+// shared L2. Every core replays its own trace and the traces interleave
+// round-robin into one global order. Given a thread each, the cores apply
+// their L1 hits in parallel. A miss or upgrade waits
+// until every access before it in the global order is done, so the counters
+// are the same as those of a single threaded run.
+
+#ifndef MULTICORE_H
+#define MULTICORE_H
+
+// cores a directory sharer mask can hold
+#define MAX_CORES 64
+
+// args holds the seven configuration arguments of the single run command
+// line and traceList the comma separated traces, one per core. threads of 0
+// means one per CPU, fewer threads than cores run every core on the calling
+// thread. Returns main's exit status.
+int runMulticore(char *args[], char *traceList, int threads);
+
+#endif
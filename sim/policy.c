@@ -0,0 +1,158 @@
+// The set passed to the hooks is the storage slot of the set, the same
+// index selectVictim and promoteWay take. wayState holds an RRPV under the
+// RRIP policies and a use count under LFU.
+#include <string.h>
+#include "policy.h"
+
+static int rripVictim(CacheLevel *cache, int set)
+{
+    unsigned char *rrpv = &cache->wayState[set * cache->associativity];
+    int oldest = 0;
+    for (int way = 1; way < cache->associativity; way++)
+    {
+        if (rrpv[way] > rrpv[oldest])
+        {
+            oldest = way;
+        }
+    }
+    // age the set until the first way reaches RRIP_MAX in one step
+    int age = RRIP_MAX - rrpv[oldest];
+    if (age > 0)
+    {
+        for (int way = 0; way < cache->associativity; way++)
+        {
+            rrpv[way] += age;
+        }
+    }
+    return oldest;
+}
+
+static void rripHit(CacheLevel *cache, int set, int way)
+{
+    cache->wayState[set * cache->associativity + way] = 0;
+}
+
+static void srripFill(CacheLevel *cache, int set, int way)
+{
+    cache->wayState[set * cache->associativity + way] = RRIP_MAX - 1;
+}
+
+static void brripFill(CacheLevel *cache, int set, int way)
+{
+    cache->fills++;
+    cache->wayState[set * cache->associativity + way] = cache->fills % BRRIP_PERIOD == 0 ? RRIP_MAX - 1 : RRIP_MAX;
+}
+
+// leader sets fill by their own policy and vote against it with every miss,
+// a high selector means SRRIP leaders miss more and followers fill as BRRIP
+static void drripFill(CacheLevel *cache, int set, int way)
+{
+    int index = cache->slotSet != NULL ? cache->slotSet[set] : set;
+    int period = cache->numSets < DUEL_PERIOD ? cache->numSets : DUEL_PERIOD;
+    int brrip;
+    if (index % period == 0)
+    {
+        cache->psel += cache->psel < (1 << PSEL_BITS) - 1;
+        brrip = 0;
+    }
+    else if (period > 1 && index % period == period - 1)
+    {
+        cache->psel -= cache->psel > 0;
+        brrip = 1;
+    }
+    else
+    {
+        brrip = cache->psel >= 1 << (PSEL_BITS - 1);
+    }
+    if (brrip)
+    {
+        brripFill(cache, set, way);
+    }
+    else
+    {
+        srripFill(cache, set, way);
+    }
+}
+
+static void lfuHit(CacheLevel *cache, int set, int way)
+{
+    unsigned char *counts = &cache->wayState[set * cache->associativity];
+    if (counts[way] == LFU_MAX)
+    {
+        for (int i = 0; i < cache->associativity; i++)
+        {
+            counts[i] >>= 1;
+        }
+    }
+    counts[way]++;
+}
+
+static void lfuFill(CacheLevel *cache, int set, int way)
+{
+    cache->wayState[set * cache->associativity + way] = 1;
+}
+
+// the least used way, the earliest filled of those tied
+static int lfuVictim(CacheLevel *cache, int set)
+{
+    int base = set * cache->associativity;
+    int victim = 0;
+    for (int way = 1; way < cache->associativity; way++)
+    {
+        if (cache->wayState[base + way] < cache->wayState[base + victim] ||
+            (cache->wayState[base + way] == cache->wayState[base + victim] && cache->rank[base + way] > cache->rank[base + victim]))
+        {
+            victim = way;
+        }
+    }
+    return victim;
+}
+
+// xorshift64*, seeded per level when the level is created
+static int randomVictim(CacheLevel *cache, int set)
+{
+    cache->random ^= cache->random >> 12;
+    cache->random ^= cache->random << 25;
+    cache->random ^= cache->random >> 27;
+    return (int)(((cache->random * 0x2545f4914f6cdd1dULL) >> 32) % cache->associativity);
+}
+
+static const ReplacementPolicy policies[] = {
+    {POLICY_LRU, "LRU", 0, 0, promoteWay, NULL, NULL},
+    {POLICY_FIFO, "FIFO", 0, 0, NULL, NULL, NULL},
+    // the engine keeps OPTIMAL's victims in a heap, its hooks only rank
+    {POLICY_OPTIMAL, "OPTIMAL", 0, 0, NULL, NULL, NULL},
+    // promoteWay walks the tree too
+    {POLICY_PLRU, "PLRU", 0, 0, promoteWay, NULL, plruVictim},
+    {POLICY_RANDOM, "RANDOM", 0, 1, NULL, NULL, randomVictim},
+    {POLICY_SRRIP, "SRRIP", 1, 0, rripHit, srripFill, rripVictim},
+    {POLICY_BRRIP, "BRRIP", 1, 1, rripHit, brripFill, rripVictim},
+    {POLICY_DRRIP, "DRRIP", 1, 1, rripHit, drripFill, rripVictim},
+    {POLICY_LFU, "LFU", 1, 0, lfuHit, lfuFill, lfuVictim},
+};
+
+#define NUM_POLICIES (int)(sizeof(policies) / sizeof(policies[0]))
+
+const ReplacementPolicy *findPolicy(int id)
+{
+    for (int i = 0; i < NUM_POLICIES; i++)
+    {
+        if (policies[i].id == id)
+        {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
+
+const ReplacementPolicy *findPolicyByName(const char *name)
+{
+    for (int i = 0; i < NUM_POLICIES; i++)
+    {
+        if (strcmp(policies[i].name, name) == 0)
+        {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
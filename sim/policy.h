@@ -0,0 +1,46 @@
+// replacement policies, each a set of hooks the engine calls on a level's
+// hits, fills, and evictions. Every policy keeps the recency ranks the
+// engine maintains on fills. The rank-based policies use them directly,
+// the others keep their own per way state in CacheLevel.wayState.
+
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "cacheEngine.h"
+
+// RRIP re-reference prediction values are 2 bits, a block at RRIP_MAX is
+// expected to be re-referenced furthest in the future
+#define RRIP_MAX 3
+// BRRIP fills 1 in BRRIP_PERIOD blocks at RRIP_MAX - 1, the rest at RRIP_MAX
+#define BRRIP_PERIOD 32
+// DRRIP dedicates 1 in DUEL_PERIOD sets to each of SRRIP and BRRIP, misses
+// in them move a PSEL_BITS saturating counter that picks the other sets'
+// insertion
+#define DUEL_PERIOD 32
+#define PSEL_BITS 10
+// LFU counts saturate at LFU_MAX, reaching it halves every count of the set
+#define LFU_MAX 15
+
+typedef struct ReplacementPolicy
+{
+    int id;
+    const char *name;
+    // per way state bytes in wayState, and whether the level carries the
+    // psel, fills, and random fields, which ties its sets together
+    int wayState;
+    int levelState;
+    // NULL leaves the ranks alone on a hit
+    void (*onHit)(CacheLevel *cache, int set, int way);
+    // after the engine ranked the filled way most recent, NULL for nothing
+    void (*onFill)(CacheLevel *cache, int set, int way);
+    // only called once every way of the set holds a block, NULL evicts the
+    // way ranked last
+    int (*selectVictim)(CacheLevel *cache, int set);
+} ReplacementPolicy;
+
+// the policy with a SimConfig.replacementPolicy value, or NULL
+const ReplacementPolicy *findPolicy(int id);
+// the policy named name, or NULL
+const ReplacementPolicy *findPolicyByName(const char *name);
+
+#endif
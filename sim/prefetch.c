@@ -0,0 +1,129 @@
+// The detectors work on block numbers only. A candidate that would wrap
+// below block 0 is dropped, the engine skips candidates already cached.
+#include <stdlib.h>
+#include "prefetch.h"
+
+Prefetcher *createPrefetcher(int kind, int degree, int distance)
+{
+    Prefetcher *prefetcher = calloc(1, sizeof(Prefetcher));
+    prefetcher->kind = kind;
+    prefetcher->degree = degree;
+    prefetcher->distance = distance;
+    return prefetcher;
+}
+
+void freePrefetcher(Prefetcher *prefetcher)
+{
+    free(prefetcher);
+}
+
+// degree blocks step apart starting distance steps past block
+static int propose(const Prefetcher *prefetcher, unsigned long long block, long long step, unsigned long long *blocks)
+{
+    int count = 0;
+    for (int i = 0; i < prefetcher->degree; i++)
+    {
+        long long offset = step * (prefetcher->distance + i);
+        if (offset < 0 && (unsigned long long)-offset > block)
+        {
+            break;
+        }
+        blocks[count++] = block + offset;
+    }
+    return count;
+}
+
+static int trainStride(Prefetcher *prefetcher, unsigned long long block, unsigned long long *blocks)
+{
+    long long stride = (long long)(block - prefetcher->lastBlock);
+    prefetcher->lastBlock = block;
+    if (stride == 0 || prefetcher->triggers == 1)
+    {
+        return 0;
+    }
+    if (stride != prefetcher->stride)
+    {
+        prefetcher->stride = stride;
+        prefetcher->confidence = 0;
+        return 0;
+    }
+    if (prefetcher->confidence < PREFETCH_CONFIDENCE)
+    {
+        prefetcher->confidence++;
+    }
+    if (prefetcher->confidence < PREFETCH_CONFIDENCE)
+    {
+        return 0;
+    }
+    return propose(prefetcher, block, stride, blocks);
+}
+
+// extend the stream the trigger falls in ahead of, or restart the least
+// recently moved one at it
+static int trainStream(Prefetcher *prefetcher, unsigned long long block, unsigned long long *blocks)
+{
+    PrefetchStream *oldest = &prefetcher->streams[0];
+    for (int i = 0; i < PREFETCH_STREAMS; i++)
+    {
+        PrefetchStream *stream = &prefetcher->streams[i];
+        if (stream->used < oldest->used)
+        {
+            oldest = stream;
+        }
+        if (stream->used == 0 || block == stream->last)
+        {
+            continue;
+        }
+        int direction = block > stream->last ? 1 : -1;
+        unsigned long long gap = direction > 0 ? block - stream->last : stream->last - block;
+        if (gap > PREFETCH_WINDOW || (stream->direction != 0 && direction != stream->direction))
+        {
+            continue;
+        }
+        stream->confidence = stream->direction == 0 ? 1 : stream->confidence + (stream->confidence < PREFETCH_CONFIDENCE);
+        stream->direction = direction;
+        stream->last = block;
+        stream->used = prefetcher->triggers;
+        if (stream->confidence < PREFETCH_CONFIDENCE)
+        {
+            return 0;
+        }
+        return propose(prefetcher, block, direction, blocks);
+    }
+    oldest->last = block;
+    oldest->direction = 0;
+    oldest->confidence = 0;
+    oldest->used = prefetcher->triggers;
+    return 0;
+}
+
+int trainPrefetcher(Prefetcher *prefetcher, unsigned long long block, unsigned long long *blocks)
+{
+    prefetcher->triggers++;
+    switch (prefetcher->kind)
+    {
+    case PREFETCH_NEXT_LINE:
+        return propose(prefetcher, block, 1, blocks);
+    case PREFETCH_STRIDE:
+        return trainStride(prefetcher, block, blocks);
+    case PREFETCH_STREAM:
+        return trainStream(prefetcher, block, blocks);
+    default:
+        return 0;
+    }
+}
+
+const char *prefetcherName(int kind)
+{
+    switch (kind)
+    {
+    case PREFETCH_NEXT_LINE:
+        return "next";
+    case PREFETCH_STRIDE:
+        return "stride";
+    case PREFETCH_STREAM:
+        return "stream";
+    default:
+        return NULL;
+    }
+}
@@ -0,0 +1,65 @@
+// hardware prefetchers for one cache level, trained on the level's demand
+// misses and first hits to prefetched blocks. They only propose block
+// numbers, the engine fills them and keeps the accuracy counters.
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stddef.h>
+
+// values of SimConfig.prefetcher
+#define PREFETCH_NONE 0
+// the degree blocks starting distance blocks past the trigger
+#define PREFETCH_NEXT_LINE 1
+// one PC-less detector over the trigger block stream, prefetches along a
+// stride once it repeats
+#define PREFETCH_STRIDE 2
+// PREFETCH_STREAMS detectors each following ascending or descending
+// triggers within PREFETCH_WINDOW blocks of the last one
+#define PREFETCH_STREAM 3
+
+#define MAX_PREFETCH_DEGREE 16
+#define PREFETCH_STREAMS 16
+#define PREFETCH_WINDOW 16
+// repeats a stride or stream needs before it is prefetched
+#define PREFETCH_CONFIDENCE 2
+
+typedef struct PrefetchStream
+{
+    unsigned long long last;
+    int direction;
+    int confidence;
+    // trigger count of the last time the stream moved, 0 when unused
+    unsigned long long used;
+} PrefetchStream;
+
+typedef struct Prefetcher
+{
+    int kind;
+    int degree;
+    int distance;
+    unsigned long long triggers;
+    // stride detector
+    unsigned long long lastBlock;
+    long long stride;
+    int confidence;
+    PrefetchStream streams[PREFETCH_STREAMS];
+    // blocks filled after the latest trigger, whether memory supplied each,
+    // and the trace position of the access that triggered them
+    unsigned long long issued[MAX_PREFETCH_DEGREE];
+    unsigned char issuedFromMemory[MAX_PREFETCH_DEGREE];
+    int issuedCount;
+    size_t issuedAt;
+} Prefetcher;
+
+Prefetcher *createPrefetcher(int kind, int degree, int distance);
+void freePrefetcher(Prefetcher *prefetcher);
+
+// train on a trigger at block, fills blocks with at most degree block
+// numbers to prefetch and returns how many
+int trainPrefetcher(Prefetcher *prefetcher, unsigned long long block, unsigned long long *blocks);
+
+// "next", "stride" or "stream", NULL for PREFETCH_NONE
+const char *prefetcherName(int kind);
+
+#endif
@@ -0,0 +1,122 @@
+// Systematic sampling in the style of SMARTS. Every period the accesses
+// before the warmup are skipped without touching the caches, the warmup is
+// simulated so the measured accesses start from warm sets, and the detail
+// accesses are counted. Rates are ratio estimates over the samples with a
+// normal 95% interval from the spread between samples.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sampling.h"
+#include "kernels.h"
+#include "estimate.h"
+
+#define SAMPLE_BATCH 4096
+
+int parseSampleConfig(char *input, SampleConfig *sample)
+{
+    char warmup[32];
+    if (sscanf(input, "%zu,%zu,%31s", &sample->period, &sample->detail, warmup) != 3)
+    {
+        return -1;
+    }
+    if (strcmp(warmup, "all") == 0)
+    {
+        sample->warmup = SAMPLE_WARM_ALL;
+    }
+    else
+    {
+        sample->warmup = strtoull(warmup, NULL, 10);
+    }
+    if (sample->detail == 0 || sample->detail > sample->period)
+    {
+        return -1;
+    }
+    if (sample->warmup == SAMPLE_WARM_ALL || sample->warmup > sample->period - sample->detail)
+    {
+        sample->warmup = sample->period - sample->detail;
+    }
+    return 0;
+}
+
+int runSampled(Simulator *sim, TraceReader *reader, const SampleConfig *sample)
+{
+    unsigned char operations[SAMPLE_BATCH];
+    unsigned long long addresses[SAMPLE_BATCH];
+    size_t skip = sample->period - sample->detail - sample->warmup;
+    size_t measureFrom = skip + sample->warmup;
+
+    int capacity = 64;
+    int count = 0;
+    Sample *samples = malloc(capacity * sizeof(Sample));
+    SimStats before = sim->stats;
+    size_t total = 0;
+    size_t simulated = 0;
+    size_t phase = 0;
+    size_t batched = 0;
+    int operation;
+    unsigned long long address;
+
+    while (nextAccess(reader, &operation, &address))
+    {
+        total++;
+        if (phase >= skip)
+        {
+            operations[batched] = operation;
+            addresses[batched] = address;
+            batched++;
+        }
+        phase++;
+        // flush where the warmup turns into the sample, where the sample
+        // ends, and whenever the batch is full
+        if (batched == SAMPLE_BATCH || phase == measureFrom || phase == sample->period)
+        {
+            simulateBatch(sim, operations, addresses, batched);
+            simulated += batched;
+            batched = 0;
+        }
+        if (phase == measureFrom)
+        {
+            before = sim->stats;
+        }
+        if (phase == sample->period)
+        {
+            if (count == capacity)
+            {
+                capacity *= 2;
+                samples = realloc(samples, capacity * sizeof(Sample));
+            }
+            memset(&samples[count], 0, sizeof(Sample));
+            addSampleDelta(&samples[count++], &sim->stats, &before);
+            phase = 0;
+        }
+    }
+    // a period cut off by the end of the trace is not measured
+    simulateBatch(sim, operations, addresses, batched);
+    simulated += batched;
+
+    if (count == 0)
+    {
+        free(samples);
+        return -1;
+    }
+
+    double l1Rate, l1Width, l2Rate, l2Width, trafficRate, trafficWidth, writeBackRate, writeBackWidth;
+    ratioEstimate(samples, count, L1_MISSES, L1_ACCESSES, 0, &l1Rate, &l1Width);
+    ratioEstimate(samples, count, L2_READ_MISSES, L2_READS, 0, &l2Rate, &l2Width);
+    ratioEstimate(samples, count, MEMORY_TRAFFIC, L1_ACCESSES, 0, &trafficRate, &trafficWidth);
+    ratioEstimate(samples, count, WRITE_BACKS, L1_ACCESSES, 0, &writeBackRate, &writeBackWidth);
+
+    printf("===== Sampled estimate (95%% confidence) =====\n");
+    printf("samples:                      %i of %zu accesses each\n", count, sample->detail);
+    printf("accesses simulated:           %zu of %zu (%.2f%%)\n", simulated, total, 100.0 * simulated / total);
+    printf("L1 miss rate:                 %f +- %f\n", l1Rate, l1Width);
+    if (sim->totalLevels > 1)
+    {
+        printf("L2 miss rate:                 %f +- %f\n", l2Rate, l2Width);
+    }
+    printf("L1 + L2 writebacks:           %.0f +- %.0f\n", writeBackRate * total, writeBackWidth * total);
+    printf("total memory traffic:         %.0f +- %.0f\n", trafficRate * total, trafficWidth * total);
+
+    free(samples);
+    return 0;
+}
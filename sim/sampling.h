@@ -0,0 +1,30 @@
+// --sample mode, the trace is split into periods and only the end of each
+// is simulated in detail, the rest skipped or used to warm the caches, and
+// the measured samples are extrapolated to the whole trace
+
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include "cacheEngine.h"
+#include "traceReader.h"
+
+// warmup that simulates every access between samples
+#define SAMPLE_WARM_ALL ((size_t)-1)
+
+typedef struct SampleConfig
+{
+    // accesses per period, the last detail of them are measured and the
+    // warmup before those simulated with their counters thrown away
+    size_t period;
+    size_t detail;
+    size_t warmup;
+} SampleConfig;
+
+// parse "period,detail,warmup" where warmup may be "all", returns 0 or -1
+int parseSampleConfig(char *input, SampleConfig *sample);
+
+// run the rest of reader through sim sampled and print the estimates with
+// 95% confidence intervals, returns 0 or -1 if no full sample fit the trace
+int runSampled(Simulator *sim, TraceReader *reader, const SampleConfig *sample);
+
+#endif
@@ -0,0 +1,205 @@
+// set-sharded replay of a single configuration
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "shard.h"
+#include "kernels.h"
+#include "policy.h"
+
+// accesses a shard gathers before handing them to its kernel
+#define SHARD_BATCH 1024
+
+typedef struct Shard
+{
+    Simulator sim;
+    const TraceBuffer *trace;
+    // trace positions of this shard's accesses, in trace order
+    size_t *positions;
+    size_t length;
+} Shard;
+
+static void *shardWorker(void *arg)
+{
+    Shard *shard = arg;
+    const TraceBuffer *trace = shard->trace;
+    SimKernel kernel = selectKernel(&shard->sim);
+
+    if (kernel != NULL)
+    {
+        // specialized kernels do not look at positions, so the shard's
+        // accesses are copied out in batches and run back to back
+        unsigned char operations[SHARD_BATCH];
+        unsigned long long addresses[SHARD_BATCH];
+        for (size_t start = 0; start < shard->length; start += SHARD_BATCH)
+        {
+            size_t n = shard->length - start < SHARD_BATCH ? shard->length - start : SHARD_BATCH;
+            for (size_t i = 0; i < n; i++)
+            {
+                size_t position = shard->positions[start + i];
+                operations[i] = trace->operations[position];
+                addresses[i] = trace->addresses[position];
+            }
+            kernel(&shard->sim, operations, addresses, n);
+        }
+        return NULL;
+    }
+
+    for (size_t i = 0; i < shard->length; i++)
+    {
+        size_t position = shard->positions[i];
+        // OPTIMAL keys are trace positions, so the shard runs on trace time
+        shard->sim.position = position;
+        simulateAccess(&shard->sim, trace->operations[position], trace->addresses[position]);
+    }
+    return NULL;
+}
+
+// move the sets a shard owns into the merged simulator
+static void mergeShard(Simulator *into, Shard *shard, int shardMask, int shardIndex)
+{
+    for (int level = 0; level < into->totalLevels; level++)
+    {
+        CacheLevel *to = into->levels[level];
+        CacheLevel *from = shard->sim.levels[level];
+        int ways = to->associativity;
+        for (int set = shardIndex; set < to->numSets; set += shardMask + 1)
+        {
+            int base = set * ways;
+            memcpy(&to->tags[base], &from->tags[base], ways * sizeof(*to->tags));
+            memcpy(&to->dirty[base], &from->dirty[base], ways * sizeof(*to->dirty));
+            memcpy(&to->rank[base], &from->rank[base], ways * sizeof(*to->rank));
+            if (to->plru != NULL)
+            {
+                to->plru[set] = from->plru[set];
+            }
+            if (to->wayState != NULL)
+            {
+                memcpy(&to->wayState[base], &from->wayState[base], ways * sizeof(*to->wayState));
+            }
+            if (to->heap != NULL)
+            {
+                memcpy(&to->nextUse[base], &from->nextUse[base], ways * sizeof(*to->nextUse));
+                memcpy(&to->heap[base], &from->heap[base], ways * sizeof(*to->heap));
+                memcpy(&to->heapIndex[base], &from->heapIndex[base], ways * sizeof(*to->heapIndex));
+                to->heapCount[set] = from->heapCount[set];
+            }
+        }
+    }
+
+    SimStats *total = &into->stats;
+    SimStats *part = &shard->sim.stats;
+    for (int level = 0; level < MAX_LEVELS; level++)
+    {
+        total->reads[level] += part->reads[level];
+        total->readMisses[level] += part->readMisses[level];
+        total->writes[level] += part->writes[level];
+        total->writeMisses[level] += part->writeMisses[level];
+        total->writeBacks[level] += part->writeBacks[level];
+        total->writeThroughs[level] += part->writeThroughs[level];
+        total->cacheToCacheTransfers[level] += part->cacheToCacheTransfers[level];
+    }
+    total->memoryTraffic += part->memoryTraffic;
+}
+
+static void runSerial(Simulator *sim, const TraceBuffer *trace, const size_t *nextUse)
+{
+    sim->nextUse = nextUse;
+    simulateBatch(sim, trace->operations, trace->addresses, trace->length);
+}
+
+int runSharded(Simulator *sim, const TraceBuffer *trace, const size_t *nextUse, int threads)
+{
+    // index bits every level has, a level without sets does not take part
+    int sharedBits = sim->levels[0]->indexBits;
+    for (int level = 1; level < sim->totalLevels; level++)
+    {
+        if (sim->levels[level]->indexBits < sharedBits)
+        {
+            sharedBits = sim->levels[level]->indexBits;
+        }
+    }
+    if (threads <= 0)
+    {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    int numShards = 1;
+    while (numShards * 2 <= threads && numShards < (1 << sharedBits))
+    {
+        numShards *= 2;
+    }
+#ifdef MISS_CLASSES
+    // the shadow fully associative caches see every set at once
+    numShards = 1;
+#endif
+    // so does the state RANDOM, BRRIP, and DRRIP keep per level
+    if (sim->levels[0]->policy->levelState)
+    {
+        numShards = 1;
+    }
+    // sets of a set sampled run are stored compacted, not in index order
+    if (sim->groupOf != NULL)
+    {
+        numShards = 1;
+    }
+    if (numShards == 1)
+    {
+        runSerial(sim, trace, nextUse);
+        return 1;
+    }
+
+    int offsetBits = sim->levels[0]->offsetBits;
+    int shardMask = numShards - 1;
+    Shard *shards = calloc(numShards, sizeof(Shard));
+    size_t *positions = malloc(trace->length * sizeof(size_t));
+    pthread_t *workers = malloc(numShards * sizeof(pthread_t));
+
+    // counting pass, then every shard gets a contiguous run of positions
+    for (size_t i = 0; i < trace->length; i++)
+    {
+        shards[(trace->addresses[i] >> offsetBits) & shardMask].length++;
+    }
+    size_t start = 0;
+    for (int s = 0; s < numShards; s++)
+    {
+        shards[s].positions = positions + start;
+        start += shards[s].length;
+        shards[s].length = 0;
+        shards[s].trace = trace;
+        createSimulator(&shards[s].sim, &sim->config);
+        shards[s].sim.nextUse = nextUse;
+    }
+    for (size_t i = 0; i < trace->length; i++)
+    {
+        Shard *shard = &shards[(trace->addresses[i] >> offsetBits) & shardMask];
+        shard->positions[shard->length++] = i;
+    }
+
+    int started = 0;
+    while (started < numShards && pthread_create(&workers[started], NULL, shardWorker, &shards[started]) == 0)
+    {
+        started++;
+    }
+    // shards that did not get a thread run here
+    for (int s = started; s < numShards; s++)
+    {
+        shardWorker(&shards[s]);
+    }
+    for (int s = 0; s < started; s++)
+    {
+        pthread_join(workers[s], NULL);
+    }
+
+    for (int s = 0; s < numShards; s++)
+    {
+        mergeShard(sim, &shards[s], shardMask, s);
+        freeSimulator(&shards[s].sim);
+    }
+    sim->nextUse = nextUse;
+    sim->position = trace->length;
+
+    free(workers);
+    free(positions);
+    free(shards);
+    return numShards;
+}
@@ -0,0 +1,17 @@
+// --parallel mode, one configuration split across threads by set
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "cacheEngine.h"
+#include "traceReader.h"
+
+// replay trace through sim on up to threads threads, 0 meaning one per
+// core. Accesses are split on the low index bits that both levels share,
+// so no two shards touch the same set, and each shard keeps trace order.
+// The merged sets and counters match a serial run exactly. Returns the
+// number of shards used, 1 when the configuration has no shared index bit,
+// is set sampled, or the build has MISS_CLASSES, and ran serially.
+int runSharded(Simulator *sim, const TraceBuffer *trace, const size_t *nextUse, int threads);
+
+#endif
@@ -0,0 +1,283 @@
+// make bench, times ./cacheSim over the bundled traces and a fixed set of
+// configurations and compares the throughput with a stored baseline
+//   ./simbench [--baseline <csv>] [--threshold <fraction>] [--runs <n>]
+// each trace is repeated into a scratch file of at least BENCH_ACCESSES
+// lines so process startup does not dominate the timing, and every CSV row
+// is the fastest of n runs. rows more than threshold slower than their
+// baseline row are reported, and the exit status is 1 when the geometric
+// mean of the throughput ratios is, one noisy row alone does not fail it
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define NUM_TRACES 5
+#define NUM_CONFIGS 5
+#define MAX_ROWS (NUM_TRACES * NUM_CONFIGS)
+#define BENCH_ACCESSES 1000000
+
+static const char *TRACES[NUM_TRACES] = {
+    "traces/gcc_trace.txt",
+    "traces/go_trace.txt",
+    "traces/perl_trace.txt",
+    "traces/vortex_trace.txt",
+    "traces/compress_trace.txt",
+};
+
+// BLOCKSIZE L1_SIZE L1_ASSOC L2_SIZE L2_ASSOC REPLACEMENT_POLICY INCLUSION_PROPERTY
+static const char *CONFIGS[NUM_CONFIGS][7] = {
+    {"16", "1024", "2", "0", "0", "LRU", "non-inclusive"},
+    {"16", "1024", "2", "8192", "4", "LRU", "inclusive"},
+    {"16", "1024", "1", "8192", "4", "FIFO", "non-inclusive"},
+    {"32", "8192", "8", "262144", "16", "LRU", "non-inclusive"},
+    {"16", "1024", "2", "8192", "4", "OPTIMAL", "inclusive"},
+};
+
+typedef struct BenchRow
+{
+    char name[128];
+    long long accesses;
+    double seconds;
+    long peakRssKb;
+} BenchRow;
+
+// run cacheSim once, returns 0 with the wall time, peak RSS, and access
+// count read back from the L1 read and write counters
+static int runOnce(const char *trace, const char **config, double *seconds, long *peakRssKb, long long *accesses)
+{
+    int output[2];
+    if (pipe(output) != 0)
+    {
+        return -1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t child = fork();
+    if (child < 0)
+    {
+        return -1;
+    }
+    if (child == 0)
+    {
+        dup2(output[1], STDOUT_FILENO);
+        close(output[0]);
+        close(output[1]);
+        execl("./cacheSim", "./cacheSim", config[0], config[1], config[2], config[3], config[4],
+              config[5], config[6], trace, (char *)NULL);
+        _exit(127);
+    }
+    close(output[1]);
+
+    FILE *report = fdopen(output[0], "r");
+    char line[256];
+    long long reads = -1;
+    long long writes = -1;
+    while (fgets(line, sizeof(line), report) != NULL)
+    {
+        sscanf(line, "a. number of L1 reads: %lld", &reads);
+        sscanf(line, "c. number of L1 writes: %lld", &writes);
+    }
+    fclose(report);
+
+    int status;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (reads < 0 || writes < 0)
+    {
+        return -1;
+    }
+
+    *seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    // ru_maxrss is in kilobytes on Linux
+    *peakRssKb = usage.ru_maxrss;
+    *accesses = reads + writes;
+    return 0;
+}
+
+// write trace over and over into a new scratch file until it holds at
+// least BENCH_ACCESSES lines, the file name goes into path
+static int repeatTrace(const char *trace, char *path)
+{
+    FILE *input = fopen(trace, "r");
+    if (input == NULL)
+    {
+        return -1;
+    }
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        fclose(input);
+        return -1;
+    }
+    FILE *output = fdopen(fd, "w");
+    char line[256];
+    long lines = 0;
+    while (lines < BENCH_ACCESSES)
+    {
+        long before = lines;
+        rewind(input);
+        while (fgets(line, sizeof(line), input) != NULL)
+        {
+            fputs(line, output);
+            lines++;
+        }
+        if (lines == before)
+        {
+            break;
+        }
+    }
+    fclose(input);
+    fclose(output);
+    return lines > 0 ? 0 : -1;
+}
+
+// rows of a baseline written by an earlier run, -1 if it cannot be read
+static int readBaseline(const char *path, BenchRow *rows)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    char line[512];
+    int count = 0;
+    while (count < MAX_ROWS && fgets(line, sizeof(line), file) != NULL)
+    {
+        double perSecond;
+        BenchRow *row = &rows[count];
+        if (sscanf(line, "%127[^,],%lld,%lf,%lf", row->name, &row->accesses, &row->seconds, &perSecond) == 4)
+        {
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *baselinePath = NULL;
+    double threshold = 0.25;
+    int runs = 5;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--baseline") == 0)
+        {
+            baselinePath = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--threshold") == 0)
+        {
+            threshold = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--runs") == 0)
+        {
+            runs = atoi(argv[i + 1]);
+        }
+    }
+    if (runs <= 0 || (argc - 1) % 2 != 0)
+    {
+        printf("Usage: ./simbench [--baseline <csv>] [--threshold <fraction>] [--runs <n>]\n");
+        return 1;
+    }
+
+    BenchRow baseline[MAX_ROWS];
+    int baselineRows = 0;
+    if (baselinePath != NULL)
+    {
+        baselineRows = readBaseline(baselinePath, baseline);
+        if (baselineRows < 0)
+        {
+            printf("Could not open file %s.\n", baselinePath);
+            return 1;
+        }
+    }
+
+    int regressions = 0;
+    int compared = 0;
+    double logRatios = 0;
+    printf("name,accesses,seconds,accesses_per_sec,ns_per_access,peak_rss_kb\n");
+    for (int t = 0; t < NUM_TRACES; t++)
+    {
+        char scratch[] = "/tmp/simbenchXXXXXX";
+        if (repeatTrace(TRACES[t], scratch) != 0)
+        {
+            printf("Could not repeat trace %s.\n", TRACES[t]);
+            return 1;
+        }
+        for (int c = 0; c < NUM_CONFIGS; c++)
+        {
+            const char **config = CONFIGS[c];
+            BenchRow row;
+            snprintf(row.name, sizeof(row.name), "%s %s %s %s %s %s %s %s", TRACES[t], config[0], config[1],
+                     config[2], config[3], config[4], config[5], config[6]);
+            row.seconds = -1;
+            row.peakRssKb = 0;
+            for (int r = 0; r < runs; r++)
+            {
+                double seconds;
+                long peakRssKb;
+                if (runOnce(scratch, config, &seconds, &peakRssKb, &row.accesses) != 0)
+                {
+                    printf(">>> ./cacheSim failed on %s\n", row.name);
+                    unlink(scratch);
+                    return 1;
+                }
+                if (row.seconds < 0 || seconds < row.seconds)
+                {
+                    row.seconds = seconds;
+                }
+                if (peakRssKb > row.peakRssKb)
+                {
+                    row.peakRssKb = peakRssKb;
+                }
+            }
+
+            double perSecond = row.accesses / row.seconds;
+            printf("%s,%lld,%.6f,%.0f,%.2f,%ld\n", row.name, row.accesses, row.seconds, perSecond,
+                   row.seconds * 1e9 / row.accesses, row.peakRssKb);
+
+            for (int b = 0; b < baselineRows; b++)
+            {
+                if (strcmp(baseline[b].name, row.name) != 0)
+                {
+                    continue;
+                }
+                double basePerSecond = baseline[b].accesses / baseline[b].seconds;
+                compared++;
+                logRatios += log(perSecond / basePerSecond);
+                if (perSecond < basePerSecond * (1 - threshold))
+                {
+                    fprintf(stderr, "slower %s: %.0f accesses/sec, baseline %.0f\n", row.name, perSecond,
+                            basePerSecond);
+                    regressions++;
+                }
+            }
+        }
+        unlink(scratch);
+    }
+
+    if (compared == 0)
+    {
+        return 0;
+    }
+    double ratio = exp(logRatios / compared);
+    fprintf(stderr, "%d of %d rows slower than the baseline by more than %.0f%%, overall throughput %.2fx baseline\n",
+            regressions, compared, threshold * 100, ratio);
+    if (ratio < 1 - threshold)
+    {
+        fprintf(stderr, "REGRESSION overall throughput below %.2fx baseline\n", 1 - threshold);
+        return 1;
+    }
+    return 0;
+}
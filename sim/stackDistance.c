@@ -0,0 +1,257 @@
+// Mattson stack distance analysis. An LRU set of A ways hits exactly when
+// fewer than A other blocks of the same set were touched since the last
+// access to the block, so one histogram of those distances per set count
+// gives the miss count of every associativity at once. Distances come from
+// a Fenwick tree that marks the latest access of each block: the marks
+// between two accesses to a block are the distinct blocks in between.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cacheSim.h"
+#include "traceReader.h"
+#include "stackDistance.h"
+
+// distance given to the first access of a block
+#define COLD_MISS -1
+
+typedef struct CurvePoint
+{
+    long long size;
+    int associativity;
+    int numSets;
+    long long misses;
+} CurvePoint;
+
+// number every distinct block of the trace 0..numBlocks-1
+static int *numberBlocks(const TraceBuffer *trace, int offsetBits, unsigned long long **blocks, int *numBlocks)
+{
+    size_t capacity = 16;
+    while (capacity < trace->length * 2)
+    {
+        capacity *= 2;
+    }
+    unsigned long long *keys = malloc(capacity * sizeof(*keys));
+    int *values = malloc(capacity * sizeof(*values));
+    int *ids = malloc(trace->length * sizeof(*ids));
+    *blocks = malloc(trace->length * sizeof(**blocks));
+    for (size_t i = 0; i < capacity; i++)
+    {
+        values[i] = -1;
+    }
+
+    *numBlocks = 0;
+    for (size_t i = 0; i < trace->length; i++)
+    {
+        unsigned long long block = trace->addresses[i] >> offsetBits;
+        size_t slot = (block * 0x9e3779b97f4a7c15ULL) & (capacity - 1);
+        while (values[slot] != -1 && keys[slot] != block)
+        {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (values[slot] == -1)
+        {
+            keys[slot] = block;
+            values[slot] = *numBlocks;
+            (*blocks)[*numBlocks] = block;
+            (*numBlocks)++;
+        }
+        ids[i] = values[slot];
+    }
+    free(keys);
+    free(values);
+    return ids;
+}
+
+static void fenwickAdd(int *tree, size_t size, size_t position, int delta)
+{
+    for (position++; position <= size; position += position & -position)
+    {
+        tree[position] += delta;
+    }
+}
+
+// sum of positions 0..position-1
+static int fenwickSum(const int *tree, size_t position)
+{
+    int sum = 0;
+    for (; position > 0; position -= position & -position)
+    {
+        sum += tree[position];
+    }
+    return sum;
+}
+
+// stack distance of every access for one set count, histogram[d] counts
+// distance d and the return value is the largest distance seen
+static int stackDistances(const TraceBuffer *trace, const int *ids, const unsigned long long *blocks,
+                          int numBlocks, int numSets, long long *histogram)
+{
+    size_t length = trace->length;
+    int *setStart = calloc(numSets + 1, sizeof(int));
+    int *setUsed = calloc(numSets, sizeof(int));
+    int *last = malloc(numBlocks * sizeof(int));
+    int *tree = calloc(length + 1, sizeof(int));
+    int maxDistance = COLD_MISS;
+
+    // each set gets its own contiguous run of positions, so a range sum
+    // inside the run only counts blocks of that set
+    for (size_t i = 0; i < length; i++)
+    {
+        setStart[(blocks[ids[i]] & (numSets - 1)) + 1]++;
+    }
+    for (int set = 0; set < numSets; set++)
+    {
+        setStart[set + 1] += setStart[set];
+    }
+    for (int i = 0; i < numBlocks; i++)
+    {
+        last[i] = COLD_MISS;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        int id = ids[i];
+        int set = blocks[id] & (numSets - 1);
+        int position = setStart[set] + setUsed[set]++;
+        if (last[id] == COLD_MISS)
+        {
+            histogram[numBlocks]++;
+        }
+        else
+        {
+            int distance = fenwickSum(tree, position) - fenwickSum(tree, last[id] + 1);
+            histogram[distance]++;
+            if (distance > maxDistance)
+            {
+                maxDistance = distance;
+            }
+            fenwickAdd(tree, length, last[id], -1);
+        }
+        fenwickAdd(tree, length, position, 1);
+        last[id] = position;
+    }
+
+    free(setStart);
+    free(setUsed);
+    free(last);
+    free(tree);
+    return maxDistance;
+}
+
+static int compareCurvePoints(const void *a, const void *b)
+{
+    const CurvePoint *x = a;
+    const CurvePoint *y = b;
+    if (x->size != y->size)
+    {
+        return x->size < y->size ? -1 : 1;
+    }
+    return x->associativity - y->associativity;
+}
+
+int runStackDistance(char *blockSizeArg, const char *traceFileName)
+{
+    SimConfig config;
+    TraceBuffer trace;
+
+    if (checkBlock(blockSizeArg, &config) != 0)
+    {
+        return 1;
+    }
+    if (loadTrace(traceFileName, &trace) != 0)
+    {
+        printf("Could not open file.\n");
+        return 1;
+    }
+    int offsetBits = log2Int(config.blockSize);
+
+    unsigned long long *blocks;
+    int numBlocks;
+    int *ids = numberBlocks(&trace, offsetBits, &blocks, &numBlocks);
+
+    // past the first set count with a set per block only cold misses are left
+    int maxSets = 1;
+    while (maxSets < numBlocks)
+    {
+        maxSets *= 2;
+    }
+
+    // one histogram bucket per distance plus the cold misses at numBlocks
+    long long *histogram = malloc((numBlocks + 1) * sizeof(long long));
+    CurvePoint *curve = NULL;
+    int numPoints = 0;
+    int capacity = 0;
+
+    printf("===== Stack distance: %s =====\n", traceFileName);
+    printf("BLOCKSIZE:\t\t%d\n", config.blockSize);
+    printf("accesses:\t\t%zu\n", trace.length);
+    printf("distinct blocks:\t%d\n", numBlocks);
+
+    for (int numSets = 1; numSets <= maxSets; numSets *= 2)
+    {
+        memset(histogram, 0, (numBlocks + 1) * sizeof(long long));
+        int maxDistance = stackDistances(&trace, ids, blocks, numBlocks, numSets, histogram);
+
+        if (numSets == 1)
+        {
+            // fully associative reuse distances, bucketed by powers of 2
+            printf("===== Fully associative reuse distance =====\n");
+            printf("%-16s%s\n", "DISTANCE", "ACCESSES");
+            for (int low = 0; low <= maxDistance; low = low == 0 ? 1 : low * 2)
+            {
+                int high = low == 0 ? 0 : low * 2 - 1;
+                long long count = 0;
+                for (int d = low; d <= high && d <= maxDistance; d++)
+                {
+                    count += histogram[d];
+                }
+                char label[32];
+                snprintf(label, sizeof(label), "%d-%d", low, high);
+                printf("%-16s%lld\n", label, count);
+            }
+            printf("%-16s%lld\n", "cold", histogram[numBlocks]);
+        }
+
+        // a way count past the largest distance only has cold misses, so
+        // stop at the first power of 2 that reaches it
+        long long misses = trace.length;
+        int distance = 0;
+        for (int associativity = 1; ; associativity *= 2)
+        {
+            for (; distance < associativity && distance <= maxDistance; distance++)
+            {
+                misses -= histogram[distance];
+            }
+            if (numPoints == capacity)
+            {
+                capacity = capacity == 0 ? 64 : capacity * 2;
+                curve = realloc(curve, capacity * sizeof(CurvePoint));
+            }
+            curve[numPoints].size = (long long)numSets * associativity * config.blockSize;
+            curve[numPoints].associativity = associativity;
+            curve[numPoints].numSets = numSets;
+            curve[numPoints].misses = misses;
+            numPoints++;
+            if (associativity > maxDistance)
+            {
+                break;
+            }
+        }
+    }
+
+    qsort(curve, numPoints, sizeof(CurvePoint), compareCurvePoints);
+    printf("===== LRU miss rate curve =====\n");
+    printf("SIZE\tASSOC\tSETS\tMISSES\tMISS_RATE\n");
+    for (int i = 0; i < numPoints; i++)
+    {
+        printf("%lld\t%d\t%d\t%lld\t%f\n", curve[i].size, curve[i].associativity, curve[i].numSets,
+               curve[i].misses, trace.length == 0 ? 0 : (double)curve[i].misses / trace.length);
+    }
+
+    free(curve);
+    free(histogram);
+    free(ids);
+    free(blocks);
+    freeTraceBuffer(&trace);
+    return 0;
+}
@@ -0,0 +1,9 @@
+// --stack-distance mode, exact LRU miss rates for every power of 2 set
+// count and associativity from one pass per set count over the trace
+
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+int runStackDistance(char *blockSizeArg, const char *traceFileName);
+
+#endif
@@ -0,0 +1,285 @@
+// sweep mode, the trace is decoded once and a pool of worker threads pulls
+// configurations off a shared counter until the grid is done
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "cacheSim.h"
+#include "traceReader.h"
+#include "kernels.h"
+#include "sweep.h"
+
+#define SWEEP_FIELDS 7
+
+typedef struct SweepJob
+{
+    SimConfig config;
+    // 0 or the createSimulator error
+    int status;
+    SimStats stats;
+} SweepJob;
+
+typedef struct SweepPool
+{
+    const TraceBuffer *trace;
+    SweepJob *jobs;
+    int numJobs;
+    int nextJob;
+    pthread_mutex_t lock;
+} SweepPool;
+
+// parse one comma separated argument into a SimConfig field per value
+// through the single run checks, returns the value count or -1
+static int parseList(char *list, int field, SimConfig **values)
+{
+    int count = 1;
+    for (char *c = list; *c != '\0'; c++)
+    {
+        count += *c == ',';
+    }
+    *values = malloc(count * sizeof(SimConfig));
+
+    char *save = NULL;
+    int parsed = 0;
+    for (char *token = strtok_r(list, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save))
+    {
+        SimConfig *value = &(*values)[parsed++];
+        int status = 0;
+        switch (field)
+        {
+        case 0:
+            status = checkBlock(token, value);
+            break;
+        case 1:
+        case 3:
+            status = checkCacheSize(token, field / 2 + 1, value);
+            break;
+        case 2:
+        case 4:
+            status = checkCacheAssoc(token, field / 2, value);
+            break;
+        case 5:
+            status = checkReplacementPolicy(token, value);
+            break;
+        default:
+            status = checkInclusionProperty(token, value);
+            break;
+        }
+        if (status != 0)
+        {
+            return -1;
+        }
+    }
+    return parsed == 0 ? -1 : parsed;
+}
+
+// counts of a set sampled run scaled up to the whole cache, rates are
+// already estimates
+static void scaleStats(SimStats *stats, double scale)
+{
+    for (int level = 0; level < MAX_LEVELS; level++)
+    {
+        stats->reads[level] *= scale;
+        stats->readMisses[level] *= scale;
+        stats->writes[level] *= scale;
+        stats->writeMisses[level] *= scale;
+        stats->writeBacks[level] *= scale;
+    }
+    stats->memoryTraffic *= scale;
+}
+
+static void *sweepWorker(void *arg)
+{
+    SweepPool *pool = arg;
+    const TraceBuffer *trace = pool->trace;
+
+    while (1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        int index = pool->nextJob++;
+        pthread_mutex_unlock(&pool->lock);
+        if (index >= pool->numJobs)
+        {
+            return NULL;
+        }
+
+        SweepJob *job = &pool->jobs[index];
+        Simulator sim;
+        job->status = createSimulator(&sim, &job->config);
+        if (job->status != 0)
+        {
+            continue;
+        }
+        size_t *nextUse = NULL;
+        if (job->config.replacementPolicy == POLICY_OPTIMAL)
+        {
+            nextUse = buildNextUse(trace->addresses, trace->length, job->config.blockSize);
+            sim.nextUse = nextUse;
+        }
+        simulateBatch(&sim, trace->operations, trace->addresses, trace->length);
+        free(nextUse);
+        finishSimulation(&sim);
+        job->stats = sim.stats;
+        if (sim.groupOf != NULL)
+        {
+            scaleStats(&job->stats, (double)sim.numGroups / sim.sampledGroups);
+        }
+        freeSimulator(&sim);
+    }
+}
+
+static void printSweep(SweepJob *jobs, int numJobs, const char *traceFileName)
+{
+    printf("===== Sweep results: %s =====\n", traceFileName);
+    if (jobs[0].config.setSampling > 1)
+    {
+        printf("1 in %d sets simulated, counts are scaled estimates\n", jobs[0].config.setSampling);
+    }
+    printf("BLOCKSIZE\tL1_SIZE\tL1_ASSOC\tL2_SIZE\tL2_ASSOC\tPOLICY\tINCLUSION\t"
+           "L1_READS\tL1_READ_MISSES\tL1_WRITES\tL1_WRITE_MISSES\tL1_MISS_RATE\tL1_WRITEBACKS\t"
+           "L2_READS\tL2_READ_MISSES\tL2_WRITES\tL2_WRITE_MISSES\tL2_MISS_RATE\tL2_WRITEBACKS\t"
+           "MEMORY_TRAFFIC\n");
+    for (int i = 0; i < numJobs; i++)
+    {
+        SimConfig *config = &jobs[i].config;
+        SimStats *stats = &jobs[i].stats;
+        printf("%d\t%d\t%d\t%d\t%d\t%s\t%s", config->blockSize,
+               config->cacheSize[0], config->associativity[0],
+               config->cacheSize[1], config->associativity[1],
+               policyName(config->replacementPolicy),
+               config->inclusionProperty == 0 ? "non-inclusive" : "inclusive");
+        if (jobs[i].status != 0)
+        {
+            // keep the column count, the row just reports why it did not run
+            if (jobs[i].status == SIM_BAD_SET_SAMPLING)
+            {
+                printf("\ttoo few sets to sample");
+            }
+            else if (jobs[i].status == SIM_BAD_PLRU_WAYS)
+            {
+                printf("\tPLRU ways is not a power of 2");
+            }
+            else
+            {
+                printf("\t%s sets is not a power of 2", jobs[i].status == SIM_BAD_L1_SETS ? "L1" : "L2");
+            }
+            for (int column = 1; column < 13; column++)
+            {
+                printf("\t-");
+            }
+            printf("\n");
+            continue;
+        }
+        for (int level = 0; level < MAX_LEVELS; level++)
+        {
+            printf("\t%lld\t%lld\t%lld\t%lld\t%f\t%lld", stats->reads[level], stats->readMisses[level],
+                   stats->writes[level], stats->writeMisses[level],
+                   stats->missRate[level], stats->writeBacks[level]);
+        }
+        printf("\t%lld\n", stats->memoryTraffic);
+    }
+}
+
+int runSweep(char *lists[], const char *traceFileName, int threads, int setSampling)
+{
+    SimConfig *values[SWEEP_FIELDS] = {NULL};
+    int counts[SWEEP_FIELDS];
+    int numJobs = 1;
+    int status = 1;
+    SweepPool pool;
+    TraceBuffer trace = {NULL, NULL, 0};
+
+    pool.jobs = NULL;
+    for (int field = 0; field < SWEEP_FIELDS; field++)
+    {
+        counts[field] = parseList(lists[field], field, &values[field]);
+        if (counts[field] < 0)
+        {
+            goto done;
+        }
+        numJobs *= counts[field];
+    }
+    if (loadTrace(traceFileName, &trace) != 0)
+    {
+        printf("Could not open file.\n");
+        goto done;
+    }
+
+    // expand the grid, the last argument varies fastest
+    pool.jobs = calloc(numJobs, sizeof(SweepJob));
+    for (int i = 0; i < numJobs; i++)
+    {
+        SimConfig *config = &pool.jobs[i].config;
+        int rest = i;
+        for (int field = SWEEP_FIELDS - 1; field >= 0; field--)
+        {
+            SimConfig *value = &values[field][rest % counts[field]];
+            rest /= counts[field];
+            switch (field)
+            {
+            case 0:
+                config->blockSize = value->blockSize;
+                break;
+            case 1:
+            case 3:
+                config->cacheSize[field / 2] = value->cacheSize[field / 2];
+                break;
+            case 2:
+            case 4:
+                config->associativity[field / 2 - 1] = value->associativity[field / 2 - 1];
+                break;
+            case 5:
+                config->replacementPolicy = value->replacementPolicy;
+                break;
+            default:
+                config->inclusionProperty = value->inclusionProperty;
+                break;
+            }
+        }
+        config->setSampling = setSampling;
+    }
+
+    if (threads <= 0)
+    {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > numJobs)
+    {
+        threads = numJobs;
+    }
+    pool.trace = &trace;
+    pool.numJobs = numJobs;
+    pool.nextJob = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    while (started < threads && pthread_create(&workers[started], NULL, sweepWorker, &pool) == 0)
+    {
+        started++;
+    }
+    // without any worker thread the grid still runs here
+    if (started == 0)
+    {
+        sweepWorker(&pool);
+    }
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    pthread_mutex_destroy(&pool.lock);
+
+    printSweep(pool.jobs, numJobs, traceFileName);
+    status = 0;
+
+done:
+    for (int field = 0; field < SWEEP_FIELDS; field++)
+    {
+        free(values[field]);
+    }
+    free(pool.jobs);
+    freeTraceBuffer(&trace);
+    return status;
+}
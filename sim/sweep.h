@@ -0,0 +1,13 @@
+// --sweep mode, every combination of the listed configurations simulated
+// over one shared in-memory copy of the trace
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+// lists holds the seven comma separated configuration arguments in the
+// order of the single run command line, threads of 0 means one per core,
+// setSampling above 1 simulates 1 in setSampling sets of every
+// configuration and scales its counters up to estimates
+int runSweep(char *lists[], const char *traceFileName, int threads, int setSampling);
+
+#endif
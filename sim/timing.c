@@ -0,0 +1,368 @@
+// The cache state and counters come from the engine unchanged, the timing
+// layer reads what an access did from how the counters moved and replays
+// that against the MSHRs and write buffer. An access is a hit, a delayed hit
+// merged into the MSHR of a block still being filled, or a miss served by
+// the level below, and its latency runs from issue until its data is there.
+// Prefetches the engine filled take an MSHR from the cycle their trigger
+// issued, waiting for the first one to free up when all are busy, so a
+// demand access that merges into one shows the prefetch came late.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timing.h"
+
+int parseTimingLatencies(char *input, TimingConfig *config)
+{
+    memset(config, 0, sizeof(*config));
+    if (sscanf(input, "%d,%d,%d", &config->hitLatency[0], &config->hitLatency[1], &config->memoryLatency) != 3)
+    {
+        return -1;
+    }
+    if (config->hitLatency[0] < 1 || config->hitLatency[1] < 1 || config->memoryLatency < 1)
+    {
+        return -1;
+    }
+    config->mshrs[0] = TIMING_MSHRS;
+    config->mshrs[1] = TIMING_MSHRS;
+    config->writeBuffer = TIMING_WRITE_BUFFER;
+    return 0;
+}
+
+int parseTimingMshrs(char *input, TimingConfig *config)
+{
+    int found = sscanf(input, "%d,%d", &config->mshrs[0], &config->mshrs[1]);
+    if (found == 1)
+    {
+        config->mshrs[1] = config->mshrs[0];
+    }
+    if (found < 1 || config->mshrs[0] < 1 || config->mshrs[1] < 1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+void startTiming(TimingModel *timing, const Simulator *sim, const TimingConfig *config)
+{
+    memset(timing, 0, sizeof(*timing));
+    timing->config = *config;
+    timing->totalLevels = sim->totalLevels;
+    timing->offsetBits = log2Int(sim->config.blockSize);
+    for (int i = 0; i < timing->totalLevels; i++)
+    {
+        timing->prefetching[i] = sim->prefetchers[i] != NULL;
+    }
+    for (int i = 0; i < timing->totalLevels; i++)
+    {
+        timing->mshrs[i] = calloc(config->mshrs[i], sizeof(Mshr));
+        timing->occupancy[i] = calloc(config->mshrs[i] + 1, sizeof(unsigned long long));
+    }
+    timing->writeBuffer = calloc(config->writeBuffer, sizeof(unsigned long long));
+}
+
+void freeTiming(TimingModel *timing)
+{
+    for (int i = 0; i < timing->totalLevels; i++)
+    {
+        free(timing->mshrs[i]);
+        free(timing->occupancy[i]);
+    }
+    free(timing->writeBuffer);
+}
+
+// move the clock to until, counting the busy MSHRs of every cycle passed
+static void advance(TimingModel *timing, unsigned long long until)
+{
+    for (; timing->now < until; timing->now++)
+    {
+        for (int i = 0; i < timing->totalLevels; i++)
+        {
+            int busy = 0;
+            for (int m = 0; m < timing->config.mshrs[i]; m++)
+            {
+                Mshr *mshr = &timing->mshrs[i][m];
+                busy += mshr->issued <= timing->now && timing->now < mshr->ready;
+            }
+            timing->occupancy[i][busy]++;
+        }
+    }
+}
+
+// the MSHR filling block at cycle t, or NULL
+static Mshr *findMshr(TimingModel *timing, int level, unsigned long long block, unsigned long long t)
+{
+    for (int m = 0; m < timing->config.mshrs[level]; m++)
+    {
+        Mshr *mshr = &timing->mshrs[level][m];
+        if (mshr->block == block && mshr->ready > t)
+        {
+            return mshr;
+        }
+    }
+    return NULL;
+}
+
+// the MSHR that frees up first, it is idle at cycle t when its ready <= t
+static Mshr *firstFree(TimingModel *timing, int level)
+{
+    Mshr *first = &timing->mshrs[level][0];
+    for (int m = 1; m < timing->config.mshrs[level]; m++)
+    {
+        if (timing->mshrs[level][m].ready < first->ready)
+        {
+            first = &timing->mshrs[level][m];
+        }
+    }
+    return first;
+}
+
+// queue a write-back that takes cost cycles in the level below, write-backs
+// overlap like misses but leave the buffer in order, and the core waits
+// while it is full
+static void writeBack(TimingModel *timing, int cost)
+{
+    unsigned long long *buffer = timing->writeBuffer;
+    int size = timing->config.writeBuffer;
+    while (timing->writeCount > 0 && buffer[timing->writeHead] <= timing->now)
+    {
+        timing->writeHead = (timing->writeHead + 1) % size;
+        timing->writeCount--;
+    }
+    if (timing->writeCount == size)
+    {
+        timing->writeBufferStalls += buffer[timing->writeHead] - timing->now;
+        advance(timing, buffer[timing->writeHead]);
+        timing->writeHead = (timing->writeHead + 1) % size;
+        timing->writeCount--;
+    }
+    unsigned long long done = timing->now + cost;
+    if (timing->writeCount > 0)
+    {
+        unsigned long long last = buffer[(timing->writeHead + timing->writeCount - 1) % size];
+        done = last > done ? last : done;
+    }
+    buffer[(timing->writeHead + timing->writeCount) % size] = done;
+    timing->writeCount++;
+}
+
+// cycle an L1 miss leaving L1 at t has its block, through the L2 MSHRs
+static unsigned long long missBelow(TimingModel *timing, unsigned long long block, unsigned long long t, int l2Miss)
+{
+    const TimingConfig *config = &timing->config;
+    if (timing->totalLevels == 1)
+    {
+        timing->served[1]++;
+        return t + config->memoryLatency;
+    }
+    Mshr *mshr = findMshr(timing, 1, block, t);
+    if (mshr != NULL)
+    {
+        timing->merged[1]++;
+        timing->latePrefetches[1] += mshr->prefetch;
+        mshr->prefetch = 0;
+        return mshr->ready > t + config->hitLatency[1] ? mshr->ready : t + config->hitLatency[1];
+    }
+    if (!l2Miss)
+    {
+        timing->served[1]++;
+        return t + config->hitLatency[1];
+    }
+    timing->served[2]++;
+    mshr = firstFree(timing, 1);
+    if (mshr->ready > t)
+    {
+        timing->l2MshrWaits += mshr->ready - t;
+        t = mshr->ready;
+    }
+    mshr->block = block;
+    mshr->issued = t;
+    mshr->ready = t + config->hitLatency[1] + config->memoryLatency;
+    mshr->prefetch = 0;
+    return mshr->ready;
+}
+
+// a block the level's prefetcher filled, through the level below or memory
+static void issuePrefetch(TimingModel *timing, int level, unsigned long long block, int fromMemory)
+{
+    const TimingConfig *config = &timing->config;
+    unsigned long long cost = config->hitLatency[level];
+    if (level + 1 < timing->totalLevels)
+    {
+        cost += config->hitLatency[level + 1];
+    }
+    if (fromMemory)
+    {
+        cost += config->memoryLatency;
+    }
+    Mshr *mshr = firstFree(timing, level);
+    unsigned long long t = mshr->ready > timing->now ? mshr->ready : timing->now;
+    mshr->block = block;
+    mshr->issued = t;
+    mshr->ready = t + cost;
+    mshr->prefetch = 1;
+}
+
+static void timeAccess(TimingModel *timing, Simulator *sim, int operation, unsigned long long address)
+{
+    const TimingConfig *config = &timing->config;
+    SimStats before = sim->stats;
+    simulateAccess(sim, operation, address);
+    const SimStats *after = &sim->stats;
+
+    int l1Miss = after->readMisses[0] + after->writeMisses[0] != before.readMisses[0] + before.writeMisses[0];
+    int l2Miss = after->readMisses[1] != before.readMisses[1];
+    int reclaimed = after->victimHits + after->writeBackHits != before.victimHits + before.writeBackHits;
+    // everything fetched from memory is a miss in the last level that the
+    // buffers beside L1 did not serve, or a prefetch, the rest of the
+    // traffic is dirty blocks written back to it
+    int last = timing->totalLevels - 1;
+    int fetched = after->readMisses[last] + after->writeMisses[last] - before.readMisses[last] - before.writeMisses[last];
+    if (last == 0 && reclaimed)
+    {
+        fetched--;
+    }
+    int prefetched = after->prefetchTraffic - before.prefetchTraffic;
+    int memoryWrites = after->memoryTraffic - before.memoryTraffic - fetched - prefetched;
+    // L2 only takes writes from L1, coalesced and still buffered ones never get there
+    int l1WriteBacks = after->writes[1] - before.writes[1];
+
+    unsigned long long block = address >> timing->offsetBits;
+    unsigned long long ready;
+    Mshr *mshr = findMshr(timing, 0, block, timing->now);
+    if (mshr != NULL)
+    {
+        timing->merged[0]++;
+        timing->latePrefetches[0] += mshr->prefetch;
+        mshr->prefetch = 0;
+        ready = mshr->ready > timing->now + config->hitLatency[0] ? mshr->ready : timing->now + config->hitLatency[0];
+    }
+    else if (!l1Miss)
+    {
+        timing->served[0]++;
+        ready = timing->now + config->hitLatency[0];
+    }
+    else if (reclaimed)
+    {
+        // the victim cache or write-back buffer is probed the cycle after L1
+        timing->buffered++;
+        ready = timing->now + config->hitLatency[0] + 1;
+    }
+    else
+    {
+        mshr = firstFree(timing, 0);
+        if (mshr->ready > timing->now)
+        {
+            timing->mshrStalls += mshr->ready - timing->now;
+            advance(timing, mshr->ready);
+        }
+        ready = missBelow(timing, block, timing->now + config->hitLatency[0], l2Miss);
+        mshr->block = block;
+        mshr->issued = timing->now;
+        mshr->ready = ready;
+        mshr->prefetch = 0;
+    }
+    timing->accesses++;
+    timing->latency += ready - timing->now;
+
+    for (int i = 0; i < timing->totalLevels; i++)
+    {
+        Prefetcher *prefetcher = sim->prefetchers[i];
+        if (prefetcher == NULL || prefetcher->issuedAt + 1 != sim->position)
+        {
+            continue;
+        }
+        for (int p = 0; p < prefetcher->issuedCount; p++)
+        {
+            issuePrefetch(timing, i, prefetcher->issued[p], prefetcher->issuedFromMemory[p]);
+        }
+    }
+
+    for (int i = 0; i < l1WriteBacks; i++)
+    {
+        writeBack(timing, config->hitLatency[1]);
+    }
+    for (int i = 0; i < memoryWrites; i++)
+    {
+        writeBack(timing, config->memoryLatency);
+        timing->memoryWrites++;
+    }
+    advance(timing, timing->now + 1);
+}
+
+void timeBatch(TimingModel *timing, Simulator *sim, const unsigned char *operations,
+               const unsigned long long *addresses, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        timeAccess(timing, sim, operations[i], addresses[i]);
+    }
+}
+
+void printTiming(TimingModel *timing)
+{
+    // the run ends when the last fill and write-back are done
+    unsigned long long end = timing->now;
+    for (int i = 0; i < timing->totalLevels; i++)
+    {
+        for (int m = 0; m < timing->config.mshrs[i]; m++)
+        {
+            end = timing->mshrs[i][m].ready > end ? timing->mshrs[i][m].ready : end;
+        }
+    }
+    if (timing->writeCount > 0)
+    {
+        int tail = (timing->writeHead + timing->writeCount - 1) % timing->config.writeBuffer;
+        end = timing->writeBuffer[tail] > end ? timing->writeBuffer[tail] : end;
+    }
+    advance(timing, end);
+
+    const TimingConfig *config = &timing->config;
+    unsigned long long stalls = timing->mshrStalls + timing->writeBufferStalls;
+    double amat = timing->accesses == 0 ? 0 : (double)timing->latency / timing->accesses;
+    printf("===== Timing (cycles) =====\n");
+    if (timing->totalLevels > 1)
+    {
+        printf("latencies:                    L1 %i, L2 %i, memory %i\n", config->hitLatency[0], config->hitLatency[1],
+               config->memoryLatency);
+    }
+    else
+    {
+        printf("latencies:                    L1 %i, memory %i\n", config->hitLatency[0], config->memoryLatency);
+    }
+    printf("AMAT:                         %f\n", amat);
+    printf("total cycles:                 %llu\n", timing->now);
+    printf("stall cycles:                 %llu\n", stalls);
+    printf("  L1 MSHRs full:              %llu\n", timing->mshrStalls);
+    printf("  write buffer full:          %llu\n", timing->writeBufferStalls);
+    printf("writes to memory:             %llu\n", timing->memoryWrites);
+    printf("L1 hits:                      %llu\n", timing->served[0]);
+    printf("merged into an L1 MSHR:       %llu\n", timing->merged[0]);
+    if (timing->buffered > 0)
+    {
+        printf("victim cache or buffer hits:  %llu\n", timing->buffered);
+    }
+    if (timing->totalLevels > 1)
+    {
+        printf("L2 hits:                      %llu\n", timing->served[1]);
+        printf("merged into an L2 MSHR:       %llu\n", timing->merged[1]);
+        printf("L2 MSHR wait cycles:          %llu\n", timing->l2MshrWaits);
+    }
+    printf("served by memory:             %llu\n", timing->served[timing->totalLevels]);
+    for (int i = 0; i < timing->totalLevels; i++)
+    {
+        if (timing->prefetching[i])
+        {
+            printf("L%d late prefetches:           %llu\n", i + 1, timing->latePrefetches[i]);
+        }
+    }
+    for (int i = 0; i < timing->totalLevels; i++)
+    {
+        printf("===== L%d MSHR occupancy (%i MSHRs) =====\n", i + 1, config->mshrs[i]);
+        for (int busy = 0; busy <= config->mshrs[i]; busy++)
+        {
+            unsigned long long cycles = timing->occupancy[i][busy];
+            printf("%3i busy:  %12llu cycles  %6.2f%%\n", busy, cycles,
+                   timing->now == 0 ? 0 : 100.0 * cycles / timing->now);
+        }
+    }
+}
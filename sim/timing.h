@@ -0,0 +1,87 @@
+// --timing mode, a latency model layered on the event counts. Every access
+// is issued one cycle after the last, misses hold an MSHR of their level
+// until the block arrives, later accesses to a block still in flight merge
+// into its MSHR, and dirty blocks leave through a write buffer. The core
+// only stalls when a miss finds every L1 MSHR busy or a write-back finds
+// the write buffer full.
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "cacheEngine.h"
+
+#define TIMING_MSHRS 8
+#define TIMING_WRITE_BUFFER 8
+
+typedef struct TimingConfig
+{
+    // cycles of a hit in each level and of a memory access
+    int hitLatency[MAX_LEVELS];
+    int memoryLatency;
+    int mshrs[MAX_LEVELS];
+    int writeBuffer;
+} TimingConfig;
+
+// a miss or prefetch in flight, busy from issued until ready
+typedef struct Mshr
+{
+    unsigned long long block;
+    unsigned long long issued;
+    unsigned long long ready;
+    // a prefetch no demand access has merged into yet
+    int prefetch;
+} Mshr;
+
+typedef struct TimingModel
+{
+    TimingConfig config;
+    int totalLevels;
+    int offsetBits;
+    // cycle the next access issues in
+    unsigned long long now;
+    Mshr *mshrs[MAX_LEVELS];
+    // per level the cycles spent with 0 to mshrs busy MSHRs
+    unsigned long long *occupancy[MAX_LEVELS];
+    // ring of the cycles the queued write-backs are done, they drain in order
+    unsigned long long *writeBuffer;
+    int writeHead;
+    int writeCount;
+    unsigned long long accesses;
+    unsigned long long latency;
+    // accesses served by each level, memory at totalLevels, and accesses
+    // merged into an MSHR of each level
+    unsigned long long served[MAX_LEVELS + 1];
+    unsigned long long merged[MAX_LEVELS];
+    // L1 misses the victim cache or write-back buffer served
+    unsigned long long buffered;
+    unsigned long long mshrStalls;
+    unsigned long long writeBufferStalls;
+    // dirty blocks queued in the write buffer on their way to memory
+    unsigned long long memoryWrites;
+    // cycles L1 misses waited for an L2 MSHR, the core keeps issuing
+    unsigned long long l2MshrWaits;
+    // per level whether it has a prefetcher, and the demand accesses that
+    // found their prefetched block still in flight
+    int prefetching[MAX_LEVELS];
+    unsigned long long latePrefetches[MAX_LEVELS];
+} TimingModel;
+
+// parse "l1,l2,memory" latencies into config and fill in the default MSHRs
+// and write buffer, returns 0 or -1
+int parseTimingLatencies(char *input, TimingConfig *config);
+// parse "n" or "l1,l2" MSHRs per level, returns 0 or -1
+int parseTimingMshrs(char *input, TimingConfig *config);
+
+// idle MSHRs and an empty write buffer for sim's levels
+void startTiming(TimingModel *timing, const Simulator *sim, const TimingConfig *config);
+void freeTiming(TimingModel *timing);
+
+// simulateAccess each access and time it
+void timeBatch(TimingModel *timing, Simulator *sim, const unsigned char *operations,
+               const unsigned long long *addresses, size_t count);
+
+// wait for the misses and write-backs in flight and print AMAT, stalls, and
+// the MSHR occupancy of the run
+void printTiming(TimingModel *timing);
+
+#endif
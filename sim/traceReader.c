@@ -0,0 +1,587 @@
+// memory-mapped trace reader with a table driven hex decoder and a
+// streaming decoder for packed traces
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef TRACE_ZLIB
+#include <zlib.h>
+#endif
+#include "traceReader.h"
+
+// value of each hex digit, 0xff for every other byte
+static unsigned char HEX_VALUE[256];
+
+static void initHexTable(void)
+{
+    if (HEX_VALUE[0] == 0xff)
+    {
+        return;
+    }
+    for (int i = 0; i < 256; i++)
+    {
+        HEX_VALUE[i] = 0xff;
+    }
+    for (int i = 0; i < 10; i++)
+    {
+        HEX_VALUE['0' + i] = i;
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        HEX_VALUE['a' + i] = 10 + i;
+        HEX_VALUE['A' + i] = 10 + i;
+    }
+}
+
+#ifdef TRACE_ZLIB
+// inflate up to n bytes of a gzip trace into to, members of a concatenated
+// file follow one another. Returns 0 at the end and -1 on damaged input.
+static ssize_t inflateStream(TraceReader *reader, unsigned char *to, size_t n)
+{
+    z_stream *stream = reader->gzip;
+    stream->next_out = to;
+    stream->avail_out = n;
+    while (stream->avail_out == n)
+    {
+        if (stream->avail_in == 0)
+        {
+            ssize_t got = read(reader->fd, reader->gzipInput, TRACE_STREAM_BUFFER);
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (got <= 0)
+            {
+                break;
+            }
+            stream->next_in = reader->gzipInput;
+            stream->avail_in = got;
+        }
+        int status = inflate(stream, Z_NO_FLUSH);
+        if (status == Z_STREAM_END)
+        {
+            inflateReset(stream);
+        }
+        else if (status != Z_OK && status != Z_BUF_ERROR)
+        {
+            errno = EIO;
+            return -1;
+        }
+    }
+    return n - stream->avail_out;
+}
+#endif
+
+// read from the trace file, or inflate from it for a gzip trace
+static ssize_t readStream(TraceReader *reader, unsigned char *to, size_t n)
+{
+#ifdef TRACE_ZLIB
+    if (reader->gzip != NULL)
+    {
+        return inflateStream(reader, to, n);
+    }
+#endif
+    return read(reader->fd, to, n);
+}
+
+// move the undecoded tail of a streamed trace to the front of its buffer
+// and read until TRACE_STREAM_MARGIN bytes are ready or the input ends, a
+// short read is kept so a live pipe is simulated as it arrives
+static void refillStream(TraceReader *reader)
+{
+    size_t left = reader->end - reader->cursor;
+    memmove(reader->buffer, reader->cursor, left);
+    while (left < TRACE_STREAM_MARGIN && !reader->eof)
+    {
+        ssize_t got = readStream(reader, reader->buffer + left, TRACE_STREAM_BUFFER - left);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            reader->eof = 1;
+            break;
+        }
+        left += got;
+    }
+    reader->cursor = reader->buffer;
+    reader->end = reader->buffer + left;
+}
+
+#ifdef TRACE_ZLIB
+// inflate a trace that starts with the gzip magic through the stream
+// buffer, what a streamed trace already read is inflated first and a
+// mapped one is read again from the start
+static int startGzip(TraceReader *reader)
+{
+    z_stream *stream = calloc(1, sizeof(z_stream));
+    reader->gzip = stream;
+    reader->gzipInput = malloc(TRACE_STREAM_BUFFER);
+    // 16 + MAX_WBITS takes the gzip header and trailer
+    if (stream == NULL || reader->gzipInput == NULL || inflateInit2(stream, 16 + MAX_WBITS) != Z_OK)
+    {
+        return -1;
+    }
+    if (reader->streaming)
+    {
+        size_t left = reader->end - reader->cursor;
+        memcpy(reader->gzipInput, reader->cursor, left);
+        stream->next_in = reader->gzipInput;
+        stream->avail_in = left;
+    }
+    else
+    {
+        munmap((void *)reader->data, reader->size);
+        reader->data = NULL;
+        reader->size = 0;
+        reader->buffer = malloc(TRACE_STREAM_BUFFER);
+        if (reader->buffer == NULL || lseek(reader->fd, 0, SEEK_SET) != 0)
+        {
+            return -1;
+        }
+        reader->streaming = 1;
+    }
+    reader->data = reader->buffer;
+    reader->cursor = reader->end = reader->buffer;
+    reader->eof = 0;
+    refillStream(reader);
+    return 0;
+}
+#endif
+
+int openTrace(TraceReader *reader, const char *path)
+{
+    struct stat info;
+
+    initHexTable();
+    // stdin is duplicated so closeTrace can close it like any other file
+    reader->fd = strcmp(path, "-") == 0 ? dup(STDIN_FILENO) : open(path, O_RDONLY);
+    if (reader->fd < 0)
+    {
+        return -1;
+    }
+    if (fstat(reader->fd, &info) != 0)
+    {
+        close(reader->fd);
+        return -1;
+    }
+
+    reader->size = 0;
+    reader->data = NULL;
+    reader->streaming = 0;
+    reader->eof = 0;
+    reader->buffer = NULL;
+    reader->rawCursor = NULL;
+    reader->rawEnd = NULL;
+    reader->packed = NULL;
+    reader->packedCapacity = 0;
+    reader->gzip = NULL;
+    reader->gzipInput = NULL;
+    if (!S_ISREG(info.st_mode))
+    {
+        // pipes and FIFOs cannot be mapped
+        reader->buffer = malloc(TRACE_STREAM_BUFFER);
+        if (reader->buffer == NULL)
+        {
+            close(reader->fd);
+            return -1;
+        }
+        reader->streaming = 1;
+        reader->data = reader->buffer;
+    }
+    else if (info.st_size > 0)
+    {
+        reader->size = info.st_size;
+        void *map = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (map == MAP_FAILED)
+        {
+            close(reader->fd);
+            return -1;
+        }
+        madvise(map, reader->size, MADV_SEQUENTIAL);
+        reader->data = map;
+    }
+    reader->cursor = reader->data;
+    reader->end = reader->data + reader->size;
+    reader->format = TRACE_TEXT;
+    reader->nextFrame = NULL;
+    reader->frame = NULL;
+    reader->frameCapacity = 0;
+    reader->previous = 0;
+    reader->count = 0;
+    if (reader->streaming)
+    {
+        refillStream(reader);
+    }
+#ifdef TRACE_ZLIB
+    if (reader->end - reader->cursor >= 2 && reader->cursor[0] == 0x1f && reader->cursor[1] == 0x8b &&
+        startGzip(reader) != 0)
+    {
+        closeTrace(reader);
+        return -1;
+    }
+#endif
+
+    const unsigned char *header = reader->cursor;
+    if (reader->end - header >= TRACE_HEADER_SIZE && memcmp(header, TRACE_MAGIC, 4) == 0)
+    {
+        if (header[4] != TRACE_VERSION)
+        {
+            closeTrace(reader);
+            return -1;
+        }
+        reader->count = readLittleEndian(header + 8, 8);
+        reader->cursor = header + TRACE_HEADER_SIZE;
+        reader->format = TRACE_PACKED;
+        if (header[5] & TRACE_FLAG_FRAMED)
+        {
+#ifdef TRACE_ZLIB
+            reader->format = TRACE_PACKED_FRAMED;
+            reader->nextFrame = reader->cursor;
+            // frames of a stream are read whole, starting with what is
+            // already buffered
+            reader->rawCursor = reader->cursor;
+            reader->rawEnd = reader->end;
+            reader->cursor = reader->end = NULL;
+#else
+            // built without zlib, framed traces cannot be inflated
+            closeTrace(reader);
+            return -1;
+#endif
+        }
+    }
+    return 0;
+}
+
+unsigned long long readLittleEndian(const unsigned char *bytes, int length)
+{
+    unsigned long long value = 0;
+    for (int i = length - 1; i >= 0; i--)
+    {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+#ifdef TRACE_ZLIB
+// make buffer hold at least size bytes, returns 0 if it cannot
+static int reserveBytes(unsigned char **buffer, size_t *capacity, size_t size)
+{
+    if (size > *capacity)
+    {
+        free(*buffer);
+        *buffer = malloc(size);
+        *capacity = *buffer == NULL ? 0 : size;
+    }
+    return *buffer != NULL;
+}
+
+// next n bytes of a streamed framed trace, what is left in the buffer first,
+// returns 0 if the input ends before
+static int streamBytes(TraceReader *reader, unsigned char *to, size_t n)
+{
+    size_t done = reader->rawEnd - reader->rawCursor;
+    if (done > n)
+    {
+        done = n;
+    }
+    memcpy(to, reader->rawCursor, done);
+    reader->rawCursor += done;
+    while (done < n)
+    {
+        ssize_t got = readStream(reader, to + done, n - done);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            return 0;
+        }
+        done += got;
+    }
+    return 1;
+}
+
+// inflate the next frame into reader->frame, returns 0 once the map or
+// stream is used up or a frame is damaged
+static int loadFrame(TraceReader *reader)
+{
+    size_t packedLength;
+    size_t rawLength;
+    const unsigned char *packed;
+
+    if (reader->streaming)
+    {
+        unsigned char header[TRACE_FRAME_HEADER_SIZE];
+        if (!streamBytes(reader, header, TRACE_FRAME_HEADER_SIZE))
+        {
+            return 0;
+        }
+        packedLength = readLittleEndian(header, 4);
+        rawLength = readLittleEndian(header + 4, 4);
+        if (!reserveBytes(&reader->packed, &reader->packedCapacity, packedLength) ||
+            !streamBytes(reader, reader->packed, packedLength))
+        {
+            return 0;
+        }
+        packed = reader->packed;
+    }
+    else
+    {
+        const unsigned char *end = reader->data + reader->size;
+        const unsigned char *header = reader->nextFrame;
+        if (header == NULL || end - header < TRACE_FRAME_HEADER_SIZE)
+        {
+            return 0;
+        }
+        packedLength = readLittleEndian(header, 4);
+        rawLength = readLittleEndian(header + 4, 4);
+        packed = header + TRACE_FRAME_HEADER_SIZE;
+        if ((size_t)(end - packed) < packedLength)
+        {
+            return 0;
+        }
+    }
+
+    if (!reserveBytes(&reader->frame, &reader->frameCapacity, rawLength))
+    {
+        return 0;
+    }
+    uLongf inflated = rawLength;
+    if (uncompress(reader->frame, &inflated, packed, packedLength) != Z_OK || inflated != rawLength)
+    {
+        return 0;
+    }
+
+    if (!reader->streaming)
+    {
+        reader->nextFrame = packed + packedLength;
+    }
+    reader->cursor = reader->frame;
+    reader->end = reader->frame + rawLength;
+    return 1;
+}
+#endif
+
+static int nextPackedAccess(TraceReader *reader, int *operation, unsigned long long *address)
+{
+    if (reader->cursor >= reader->end)
+    {
+#ifdef TRACE_ZLIB
+        if (reader->format != TRACE_PACKED_FRAMED || !loadFrame(reader))
+        {
+            return 0;
+        }
+#else
+        return 0;
+#endif
+    }
+
+    const unsigned char *p = reader->cursor;
+    const unsigned char *end = reader->end;
+    unsigned long long value = 0;
+    int shift = 0;
+    // a record never straddles a frame, a record cut off by the end of the map is dropped
+    while (p < end && (*p & 0x80))
+    {
+        value |= (unsigned long long)(*p & 0x7f) << shift;
+        shift += 7;
+        p++;
+    }
+    if (p >= end)
+    {
+        reader->cursor = end;
+        return 0;
+    }
+    value |= (unsigned long long)*p << shift;
+    reader->cursor = p + 1;
+
+    *operation = value & 1;
+    unsigned long long zigzag = value >> 1;
+    reader->previous += (zigzag >> 1) ^ -(zigzag & 1);
+    *address = reader->previous;
+    return 1;
+}
+
+static int nextTextAccess(TraceReader *reader, int *operation, unsigned long long *address)
+{
+    const unsigned char *p = reader->cursor;
+    const unsigned char *end = reader->end;
+
+    // skip blank lines and leading whitespace
+    while (p < end && *p <= ' ')
+    {
+        p++;
+    }
+    if (p >= end)
+    {
+        reader->cursor = p;
+        return 0;
+    }
+
+    *operation = (*p | 0x20) == 'w';
+    p++;
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+
+    unsigned long long value = 0;
+    unsigned char digit;
+    while (p < end && (digit = HEX_VALUE[*p]) != 0xff)
+    {
+        value = (value << 4) | digit;
+        p++;
+    }
+    *address = value;
+
+    // drop anything else on the line
+    while (p < end && *p != '\n')
+    {
+        p++;
+    }
+    reader->cursor = p;
+    return 1;
+}
+
+int nextAccess(TraceReader *reader, int *operation, unsigned long long *address)
+{
+    // frames are read whole, everything else keeps a margin buffered
+    if (reader->streaming && reader->format != TRACE_PACKED_FRAMED &&
+        reader->end - reader->cursor < TRACE_STREAM_MARGIN && !reader->eof)
+    {
+        refillStream(reader);
+    }
+    if (reader->format == TRACE_TEXT)
+    {
+        return nextTextAccess(reader, operation, address);
+    }
+    return nextPackedAccess(reader, operation, address);
+}
+
+// 0 when decoding the next access would first wait on a read of a
+// streamed trace
+static int accessReady(const TraceReader *reader)
+{
+    if (!reader->streaming || reader->eof)
+    {
+        return 1;
+    }
+    if (reader->format == TRACE_PACKED_FRAMED)
+    {
+        return reader->cursor < reader->end;
+    }
+    return reader->end - reader->cursor >= TRACE_STREAM_MARGIN;
+}
+
+size_t nextAccesses(TraceReader *reader, unsigned char *operations, unsigned long long *addresses, size_t most)
+{
+    size_t count = 0;
+    int operation;
+    while (count < most && (count == 0 || accessReady(reader)) && nextAccess(reader, &operation, &addresses[count]))
+    {
+        operations[count++] = operation;
+    }
+    return count;
+}
+
+void closeTrace(TraceReader *reader)
+{
+    if (reader->data != NULL && !reader->streaming)
+    {
+        munmap((void *)reader->data, reader->size);
+    }
+    close(reader->fd);
+    free(reader->frame);
+    free(reader->buffer);
+    free(reader->packed);
+#ifdef TRACE_ZLIB
+    if (reader->gzip != NULL)
+    {
+        inflateEnd(reader->gzip);
+    }
+#endif
+    free(reader->gzip);
+    free(reader->gzipInput);
+    reader->gzip = NULL;
+    reader->gzipInput = NULL;
+    reader->frame = NULL;
+    reader->buffer = NULL;
+    reader->packed = NULL;
+    reader->data = NULL;
+    reader->fd = -1;
+}
+
+int loadTrace(const char *path, TraceBuffer *trace)
+{
+    TraceReader reader;
+
+    trace->addresses = NULL;
+    trace->operations = NULL;
+    trace->length = 0;
+    if (openTrace(&reader, path) != 0)
+    {
+        return -1;
+    }
+    return loadOpenTrace(&reader, trace);
+}
+
+int loadOpenTrace(TraceReader *reader, TraceBuffer *trace)
+{
+    int operation;
+    unsigned long long address;
+
+    trace->addresses = NULL;
+    trace->operations = NULL;
+    trace->length = 0;
+
+    // packed traces know their length, text traces grow by doubling
+    size_t capacity = reader->count > 0 ? reader->count : 1 << 16;
+    while (1)
+    {
+        unsigned long long *addresses = realloc(trace->addresses, capacity * sizeof(*addresses));
+        unsigned char *operations = realloc(trace->operations, capacity);
+        if (addresses != NULL)
+        {
+            trace->addresses = addresses;
+        }
+        if (operations != NULL)
+        {
+            trace->operations = operations;
+        }
+        if (addresses == NULL || operations == NULL)
+        {
+            closeTrace(reader);
+            freeTraceBuffer(trace);
+            return -1;
+        }
+
+        while (trace->length < capacity && nextAccess(reader, &operation, &address))
+        {
+            trace->addresses[trace->length] = address;
+            trace->operations[trace->length] = operation;
+            trace->length++;
+        }
+        if (trace->length < capacity)
+        {
+            break;
+        }
+        capacity *= 2;
+    }
+    closeTrace(reader);
+    return 0;
+}
+
+void freeTraceBuffer(TraceBuffer *trace)
+{
+    free(trace->addresses);
+    free(trace->operations);
+    trace->addresses = NULL;
+    trace->operations = NULL;
+    trace->length = 0;
+}
@@ -0,0 +1,107 @@
+// memory-mapped reader for "r|w <hex address>" trace files and the packed
+// binary traces written by tracepack, pipes, FIFOs, and "-" for stdin are
+// streamed through a fixed buffer instead, and so are gzip compressed
+// traces of either kind when built with zlib
+
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <stddef.h>
+
+// packed trace layout, all integers little endian
+//   header: "CTRC", version, flags, 2 reserved bytes, u64 access count
+//   record: LEB128 varint of (zigzag(address - previous address) << 1) | op
+// with TRACE_FLAG_FRAMED the records are split into frames, each a u32
+// packed length and u32 raw length followed by a deflate stream, and the
+// address delta carries over from one frame to the next
+#define TRACE_MAGIC "CTRC"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 16
+#define TRACE_FRAME_HEADER_SIZE 8
+#define TRACE_FLAG_FRAMED 0x01
+// records of one frame before it is compressed
+#define TRACE_FRAME_SIZE (1 << 20)
+// zigzag needs one spare bit and the op another, so packed addresses stop at 62 bits
+#define TRACE_MAX_ADDRESS ((1ULL << 62) - 1)
+
+// read buffer of a streamed trace
+#define TRACE_STREAM_BUFFER (1 << 16)
+// bytes kept ahead of the cursor of a streamed trace, a text line longer
+// than this is cut
+#define TRACE_STREAM_MARGIN 256
+
+enum TraceFormat
+{
+    TRACE_TEXT,
+    TRACE_PACKED,
+    TRACE_PACKED_FRAMED
+};
+
+typedef struct TraceReader
+{
+    int fd;
+    int format;
+    const unsigned char *data;
+    size_t size;
+    // records still to decode, inside the map or the current frame
+    const unsigned char *cursor;
+    const unsigned char *end;
+    // framed traces only, next frame header in the map and the inflated frame
+    const unsigned char *nextFrame;
+    unsigned char *frame;
+    size_t frameCapacity;
+    unsigned long long previous;
+    unsigned long long count;
+    // streamed traces only, data is the read buffer and for framed traces
+    // rawCursor to rawEnd is what is left of it once frames take over
+    int streaming;
+    int eof;
+    unsigned char *buffer;
+    const unsigned char *rawCursor;
+    const unsigned char *rawEnd;
+    unsigned char *packed;
+    size_t packedCapacity;
+    // gzip compressed traces only, the inflate stream and the compressed
+    // bytes read ahead of it
+    void *gzip;
+    unsigned char *gzipInput;
+} TraceReader;
+
+// a whole trace decoded into memory, shared read-only by simulations that
+// replay it
+typedef struct TraceBuffer
+{
+    unsigned long long *addresses;
+    // 0 for read, 1 for write
+    unsigned char *operations;
+    size_t length;
+} TraceBuffer;
+
+// map a trace file or start streaming stdin ("-") or a pipe, returns 0 on
+// success and -1 if it cannot be opened or is a packed trace this build
+// cannot decode
+int openTrace(TraceReader *reader, const char *path);
+
+// decode the next access, operation is 0 for read and 1 for write
+// returns 1 when an access was read and 0 at the end of the trace
+int nextAccess(TraceReader *reader, int *operation, unsigned long long *address);
+
+// decode up to most accesses, stopping early once a streamed trace has
+// nothing more buffered so what already arrived is not held back by a read.
+// Returns how many were decoded, 0 only at the end of the trace.
+size_t nextAccesses(TraceReader *reader, unsigned char *operations, unsigned long long *addresses, size_t most);
+
+void closeTrace(TraceReader *reader);
+
+// decode every access of a trace file, returns 0 on success and -1 if it
+// cannot be opened or there is not enough memory
+int loadTrace(const char *path, TraceBuffer *trace);
+// the same for a reader openTrace already started, which is closed after,
+// so a stream can be loaded without opening it twice
+int loadOpenTrace(TraceReader *reader, TraceBuffer *trace);
+void freeTraceBuffer(TraceBuffer *trace);
+
+// unsigned integer of length bytes stored least significant byte first
+unsigned long long readLittleEndian(const unsigned char *bytes, int length);
+
+#endif
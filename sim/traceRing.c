@@ -0,0 +1,163 @@
+// Each side owns one counter. The reader publishes a batch by bumping filled
+// with release order after writing it, the simulation gives one back by
+// bumping returned once it is done reading it. filled - returned is the
+// number of batches in flight. While the ring is full or empty a side polls
+// the other's counter briefly and then sleeps on the condition variable,
+// which every counter move signals. With a single CPU the thread could only
+// take turns with the simulation, so the batches are decoded inline.
+#include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
+#include "traceRing.h"
+
+// polls of the other side's counter before sleeping
+#define RING_SPINS 64
+
+static void unlockRing(void *arg)
+{
+    pthread_mutex_unlock(&((TraceRing *)arg)->lock);
+}
+
+// wake the other side after moving a counter
+static void wakeRing(TraceRing *ring)
+{
+    pthread_mutex_lock(&ring->lock);
+    pthread_cond_broadcast(&ring->moved);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+static int ringFull(TraceRing *ring, size_t filled)
+{
+    return filled - atomic_load_explicit(&ring->returned, memory_order_acquire) == TRACE_RING_BATCHES;
+}
+
+static int ringEmpty(TraceRing *ring, size_t returned)
+{
+    return atomic_load_explicit(&ring->filled, memory_order_acquire) == returned &&
+           !atomic_load_explicit(&ring->done, memory_order_acquire);
+}
+
+static void *readBatches(void *arg)
+{
+    TraceRing *ring = arg;
+    size_t filled = 0;
+    for (;;)
+    {
+        for (int spins = 0; ringFull(ring, filled); spins++)
+        {
+            if (spins < RING_SPINS)
+            {
+                sched_yield();
+                continue;
+            }
+            // cancelled while waiting, the lock is given back on the way out
+            pthread_mutex_lock(&ring->lock);
+            pthread_cleanup_push(unlockRing, ring);
+            while (ringFull(ring, filled))
+            {
+                pthread_cond_wait(&ring->moved, &ring->lock);
+            }
+            pthread_cleanup_pop(1);
+        }
+
+        TraceBatch *batch = &ring->batches[filled % TRACE_RING_BATCHES];
+        batch->count = nextAccesses(ring->reader, batch->operations, batch->addresses, TRACE_RING_BATCH);
+        if (batch->count == 0)
+        {
+            break;
+        }
+        atomic_store_explicit(&ring->filled, ++filled, memory_order_release);
+        wakeRing(ring);
+        pthread_testcancel();
+    }
+    atomic_store_explicit(&ring->done, 1, memory_order_release);
+    wakeRing(ring);
+    return NULL;
+}
+
+int startTraceRing(TraceRing *ring, TraceReader *reader)
+{
+    ring->reader = reader;
+    ring->threaded = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+    ring->batches = malloc((ring->threaded ? TRACE_RING_BATCHES : 1) * sizeof(TraceBatch));
+    if (ring->batches == NULL)
+    {
+        return -1;
+    }
+    atomic_init(&ring->filled, 0);
+    atomic_init(&ring->returned, 0);
+    atomic_init(&ring->done, 0);
+    ring->holding = 0;
+    if (!ring->threaded)
+    {
+        return 0;
+    }
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->moved, NULL);
+    if (pthread_create(&ring->thread, NULL, readBatches, ring) != 0)
+    {
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->moved);
+        free(ring->batches);
+        ring->batches = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+const TraceBatch *nextTraceBatch(TraceRing *ring)
+{
+    if (!ring->threaded)
+    {
+        TraceBatch *batch = &ring->batches[0];
+        batch->count = nextAccesses(ring->reader, batch->operations, batch->addresses, TRACE_RING_BATCH);
+        return batch->count > 0 ? batch : NULL;
+    }
+    size_t returned = atomic_load_explicit(&ring->returned, memory_order_relaxed);
+    if (ring->holding)
+    {
+        atomic_store_explicit(&ring->returned, ++returned, memory_order_release);
+        ring->holding = 0;
+        wakeRing(ring);
+    }
+    for (int spins = 0; ringEmpty(ring, returned); spins++)
+    {
+        if (spins < RING_SPINS)
+        {
+            sched_yield();
+            continue;
+        }
+        pthread_mutex_lock(&ring->lock);
+        while (ringEmpty(ring, returned))
+        {
+            pthread_cond_wait(&ring->moved, &ring->lock);
+        }
+        pthread_mutex_unlock(&ring->lock);
+    }
+    // done is set after the last batch was published, so filled is read
+    // again before giving up
+    if (atomic_load_explicit(&ring->filled, memory_order_acquire) == returned)
+    {
+        return NULL;
+    }
+    ring->holding = 1;
+    return &ring->batches[returned % TRACE_RING_BATCHES];
+}
+
+void stopTraceRing(TraceRing *ring)
+{
+    if (ring->threaded)
+    {
+        // a run stopping early may find the reader blocked on a read of a
+        // live pipe, which cancelling it interrupts
+        if (!atomic_load_explicit(&ring->done, memory_order_acquire))
+        {
+            pthread_cancel(ring->thread);
+        }
+        pthread_join(ring->thread, NULL);
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->moved);
+    }
+    free(ring->batches);
+    ring->batches = NULL;
+}
@@ -0,0 +1,58 @@
+// a reader thread that decodes a trace ahead of the simulation into a ring
+// of fixed size batches. The ring is single producer, single consumer and
+// its counters are lock free, the simulation only waits when the reader has
+// fallen behind.
+
+#ifndef TRACE_RING_H
+#define TRACE_RING_H
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include "traceReader.h"
+
+// accesses of one batch and batches in the ring
+#define TRACE_RING_BATCH (1 << 14)
+#define TRACE_RING_BATCHES 4
+
+typedef struct TraceBatch
+{
+    unsigned char operations[TRACE_RING_BATCH];
+    unsigned long long addresses[TRACE_RING_BATCH];
+    size_t count;
+} TraceBatch;
+
+typedef struct TraceRing
+{
+    TraceReader *reader;
+    TraceBatch *batches;
+    // batches the reader filled and the simulation gave back, each written
+    // only by its own side
+    atomic_size_t filled;
+    atomic_size_t returned;
+    // set by the reader after its last batch
+    atomic_int done;
+    // taken to sleep on moved while the ring is full or empty
+    pthread_mutex_t lock;
+    pthread_cond_t moved;
+    // the simulation holds the batch at returned until it asks for the next
+    int holding;
+    // 0 when there is one CPU and nextTraceBatch decodes the batches itself
+    int threaded;
+    pthread_t thread;
+} TraceRing;
+
+// start decoding reader on its own thread when there is more than one CPU,
+// the reader belongs to the ring until stopTraceRing. Returns 0 on success and -1 if there is not enough
+// memory or the thread cannot start.
+int startTraceRing(TraceRing *ring, TraceReader *reader);
+
+// give back the batch returned before and wait for the next, NULL at the
+// end of the trace. A batch is full unless the trace ended or a streamed
+// trace had nothing more buffered, so a live pipe is simulated as it arrives.
+const TraceBatch *nextTraceBatch(TraceRing *ring);
+
+// stop the reader thread, cancelling it when the trace is not done, and
+// free the batches, the reader is left open
+void stopTraceRing(TraceRing *ring);
+
+#endif
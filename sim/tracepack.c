@@ -0,0 +1,257 @@
+// converts ASCII traces into the packed binary format read by cacheSim
+//   ./tracepack [-z] <trace_file> <packed_file>
+//   ./tracepack [-z] <actions_file> <addresses_file> <packed_file>
+// the first form takes the "r|w <hex address>" traces in sim/traces, the
+// second the split rtl/traces files where each action is the hex ASCII code
+// of R or W, -z writes deflate compressed frames
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef TRACE_ZLIB
+#include <zlib.h>
+#endif
+#include "traceReader.h"
+
+typedef struct TraceWriter
+{
+    FILE *file;
+    int framed;
+    unsigned long long previous;
+    unsigned long long count;
+    // records waiting to be written, one frame worth when framed
+    unsigned char *buffer;
+    size_t used;
+    unsigned char *packed;
+    size_t packedCapacity;
+} TraceWriter;
+
+static void writeLittleEndian(unsigned char *bytes, unsigned long long value, int length)
+{
+    for (int i = 0; i < length; i++)
+    {
+        bytes[i] = value >> (8 * i);
+    }
+}
+
+static int flushRecords(TraceWriter *writer)
+{
+    if (writer->used == 0)
+    {
+        return 0;
+    }
+#ifdef TRACE_ZLIB
+    if (writer->framed)
+    {
+        unsigned char header[TRACE_FRAME_HEADER_SIZE];
+        uLongf packedLength = writer->packedCapacity;
+        if (compress2(writer->packed, &packedLength, writer->buffer, writer->used, Z_BEST_SPEED) != Z_OK)
+        {
+            return -1;
+        }
+        writeLittleEndian(header, packedLength, 4);
+        writeLittleEndian(header + 4, writer->used, 4);
+        if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header) ||
+            fwrite(writer->packed, 1, packedLength, writer->file) != packedLength)
+        {
+            return -1;
+        }
+        writer->used = 0;
+        return 0;
+    }
+#endif
+    if (fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used)
+    {
+        return -1;
+    }
+    writer->used = 0;
+    return 0;
+}
+
+static int openWriter(TraceWriter *writer, const char *path, int framed)
+{
+    unsigned char header[TRACE_HEADER_SIZE] = {0};
+
+    memset(writer, 0, sizeof(*writer));
+    writer->framed = framed;
+    writer->buffer = malloc(TRACE_FRAME_SIZE);
+#ifdef TRACE_ZLIB
+    if (framed)
+    {
+        writer->packedCapacity = compressBound(TRACE_FRAME_SIZE);
+        writer->packed = malloc(writer->packedCapacity);
+    }
+#endif
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL || writer->buffer == NULL || (framed && writer->packed == NULL))
+    {
+        return -1;
+    }
+
+    // the access count is patched in by closeWriter
+    memcpy(header, TRACE_MAGIC, 4);
+    header[4] = TRACE_VERSION;
+    header[5] = framed ? TRACE_FLAG_FRAMED : 0;
+    return fwrite(header, 1, sizeof(header), writer->file) == sizeof(header) ? 0 : -1;
+}
+
+static int writeAccess(TraceWriter *writer, int operation, unsigned long long address)
+{
+    // the longest record is a 64 bit varint, 10 bytes
+    if (writer->used + 10 > TRACE_FRAME_SIZE && flushRecords(writer) != 0)
+    {
+        return -1;
+    }
+
+    long long delta = (long long)(address - writer->previous);
+    unsigned long long value = ((((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63)) << 1) | (operation & 1);
+    writer->previous = address;
+    writer->count++;
+
+    while (value >= 0x80)
+    {
+        writer->buffer[writer->used++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    writer->buffer[writer->used++] = value;
+    return 0;
+}
+
+static int closeWriter(TraceWriter *writer)
+{
+    unsigned char count[8];
+    int status = 0;
+
+    if (writer->file != NULL)
+    {
+        writeLittleEndian(count, writer->count, 8);
+        if (flushRecords(writer) != 0 || fseek(writer->file, 8, SEEK_SET) != 0 ||
+            fwrite(count, 1, sizeof(count), writer->file) != sizeof(count))
+        {
+            status = -1;
+        }
+        if (fclose(writer->file) != 0)
+        {
+            status = -1;
+        }
+    }
+    free(writer->buffer);
+    free(writer->packed);
+    return status;
+}
+
+// sim/traces layout, read through the same reader cacheSim uses
+static int packTrace(TraceWriter *writer, const char *tracePath)
+{
+    TraceReader reader;
+    int operation;
+    unsigned long long address;
+
+    if (openTrace(&reader, tracePath) != 0)
+    {
+        printf("Could not open file %s.\n", tracePath);
+        return -1;
+    }
+    while (nextAccess(&reader, &operation, &address))
+    {
+        if (address > TRACE_MAX_ADDRESS || writeAccess(writer, operation, address) != 0)
+        {
+            printf(">>> Failed to pack access %llu\n", writer->count);
+            closeTrace(&reader);
+            return -1;
+        }
+    }
+    closeTrace(&reader);
+    return 0;
+}
+
+// rtl/traces layout, one hex ASCII action per line next to one 48 bit address per line
+static int packSplitTrace(TraceWriter *writer, const char *actionPath, const char *addressPath)
+{
+    FILE *actions = fopen(actionPath, "r");
+    FILE *addresses = fopen(addressPath, "r");
+    unsigned int action;
+    unsigned long long address;
+    int status = 0;
+
+    if (actions == NULL || addresses == NULL)
+    {
+        printf("Could not open file %s.\n", actions == NULL ? actionPath : addressPath);
+        status = -1;
+    }
+    while (status == 0 && fscanf(actions, "%x", &action) == 1)
+    {
+        if (fscanf(addresses, "%llx", &address) != 1)
+        {
+            printf(">>> %s has fewer lines than %s\n", addressPath, actionPath);
+            status = -1;
+        }
+        else if ((action | 0x20) != 'r' && (action | 0x20) != 'w')
+        {
+            printf(">>> Unknown action %x at access %llu\n", action, writer->count);
+            status = -1;
+        }
+        else if (address > TRACE_MAX_ADDRESS || writeAccess(writer, (action | 0x20) == 'w', address) != 0)
+        {
+            printf(">>> Failed to pack access %llu\n", writer->count);
+            status = -1;
+        }
+    }
+    if (actions != NULL)
+    {
+        fclose(actions);
+    }
+    if (addresses != NULL)
+    {
+        fclose(addresses);
+    }
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    int framed = 0;
+    int first = 1;
+    TraceWriter writer;
+
+    if (argc > 1 && strcmp(argv[1], "-z") == 0)
+    {
+        framed = 1;
+        first = 2;
+    }
+    int inputs = argc - first - 1;
+    if (inputs != 1 && inputs != 2)
+    {
+        printf("Usage: ./tracepack [-z] <trace_file> <packed_file>\n");
+        printf("       ./tracepack [-z] <actions_file> <addresses_file> <packed_file>\n");
+        return 1;
+    }
+#ifndef TRACE_ZLIB
+    if (framed)
+    {
+        printf(">>> tracepack was built without zlib, -z is not available\n");
+        return 1;
+    }
+#endif
+
+    const char *output = argv[argc - 1];
+    if (openWriter(&writer, output, framed) != 0)
+    {
+        printf("Could not open file %s.\n", output);
+        closeWriter(&writer);
+        return 1;
+    }
+    int status = inputs == 1 ? packTrace(&writer, argv[first])
+                             : packSplitTrace(&writer, argv[first], argv[first + 1]);
+    if (closeWriter(&writer) != 0)
+    {
+        printf("Could not write file %s.\n", output);
+        status = -1;
+    }
+    if (status != 0)
+    {
+        remove(output);
+        return 1;
+    }
+    printf("%s: %llu accesses\n", output, writer.count);
+    return 0;
+}